@@ -0,0 +1,24 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic<int64_t> gAllocationCount = 0;
+std::atomic<int64_t> gAllocatedBytes = 0;
+
+void* operator new(std::size_t size) {
+   gAllocationCount.fetch_add(1, std::memory_order::relaxed);
+   gAllocatedBytes.fetch_add((int64_t)size, std::memory_order::relaxed);
+   if (void* ptr = std::malloc(size ? size : 1)) {
+      return ptr;
+   }
+   throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+   std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+   std::free(ptr);
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Heap allocations of the whole process, global operator new is replaced in AllocationCounter.cpp
+extern std::atomic<int64_t> gAllocationCount;
+// Bytes requested from operator new, never decremented
+extern std::atomic<int64_t> gAllocatedBytes;
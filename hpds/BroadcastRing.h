@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CacheLine.h"
+
+// Single producer multicast ring (LMAX Disruptor style): every consumer sees every element, nothing is copied per consumer.
+// Each consumer owns a sequence, the count of elements it has released. A consumer may depend on others and then only
+// sees elements all of them have released, that builds processing stages (e.g. risk check before matcher).
+// The producer is gated by the slowest consumer. Sequences never wrap, capacity must be a power of two.
+// Consumers are added before the producer starts.
+template<typename T>
+class BroadcastRing {
+public:
+   BroadcastRing(int capacity) : buffer(capacity), mask(capacity - 1) {
+      assert(std::has_single_bit((unsigned)capacity));
+   }
+
+   // Returns the consumer id, dependencies must be already added consumers
+   int AddConsumer(const std::vector<int>& dependsOn = {}) {
+      auto consumer = std::make_unique<Consumer>();
+      for (int upstream : dependsOn) {
+         assert(upstream < (int)consumers.size());
+         consumer->upstream.push_back(&consumers[upstream]->sequence);
+      }
+      consumers.push_back(std::move(consumer));
+      return (int)consumers.size() - 1;
+   }
+
+   // Producer side, slot for the next element or nullptr if the slowest consumer is a whole ring behind
+   T* TryClaim() {
+      int64_t next = published.load(std::memory_order::relaxed);
+      if (next - gateCached >= Capacity()) {
+         gateCached = SlowestSequence();
+         if (next - gateCached >= Capacity()) {
+            return nullptr;
+         }
+      }
+      return &buffer[next & mask];
+   }
+
+   void Commit() {
+      published.store(published.load(std::memory_order::relaxed) + 1, std::memory_order::release);
+   }
+
+   bool Push(const T& data) {
+      T* slot = TryClaim();
+      if (!slot) {
+         return false;
+      }
+      *slot = data;
+      Commit();
+      return true;
+   }
+
+   // Consumer side, next element for this consumer or nullptr. Valid until Release
+   const T* Peek(int consumerId) {
+      Consumer& consumer = *consumers[consumerId];
+      int64_t next = consumer.sequence.load(std::memory_order::relaxed);
+      if (next == consumer.availableCached) {
+         consumer.availableCached = Available(consumer);
+         if (next == consumer.availableCached) {
+            return nullptr;
+         }
+      }
+      return &buffer[next & mask];
+   }
+
+   void Release(int consumerId) {
+      std::atomic<int64_t>& sequence = consumers[consumerId]->sequence;
+      sequence.store(sequence.load(std::memory_order::relaxed) + 1, std::memory_order::release);
+   }
+
+   int Capacity() const {
+      return (int)buffer.size();
+   }
+
+   int Consumers() const {
+      return (int)consumers.size();
+   }
+
+private:
+   struct Consumer {
+      ALIGN_CACHE_LINE std::atomic<int64_t> sequence = 0;
+      // touched only by the consumer thread
+      ALIGN_CACHE_LINE int64_t availableCached = 0;
+      std::vector<const std::atomic<int64_t>*> upstream;
+   };
+
+   std::vector<T> buffer;
+   int64_t mask;
+   std::vector<std::unique_ptr<Consumer>> consumers;
+
+   ALIGN_CACHE_LINE std::atomic<int64_t> published = 0;
+   // producer only
+   ALIGN_CACHE_LINE int64_t gateCached = 0;
+
+   // Same idea as headCached/tailCached in RingBuffer: shared sequences are read only when the cached bound is reached
+   int64_t Available(const Consumer& consumer) const {
+      int64_t available = published.load(std::memory_order::acquire);
+      for (const auto* upstream : consumer.upstream) {
+         available = std::min(available, upstream->load(std::memory_order::acquire));
+      }
+      return available;
+   }
+
+   int64_t SlowestSequence() const {
+      int64_t minSequence = published.load(std::memory_order::relaxed);
+      for (const auto& consumer : consumers) {
+         minSequence = std::min(minSequence, consumer->sequence.load(std::memory_order::acquire));
+      }
+      return minSequence;
+   }
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "CacheLine.h"
+
+// Record header, payload follows it. Records start at 8 byte aligned offsets, so does the payload
+struct ByteRingRecord {
+   static constexpr uint32_t kPadding = ~0u; // reserved type, fills the tail of the buffer before a wrap
+
+   uint32_t size; // payload bytes
+   uint32_t type; // user message type
+
+   std::byte* Data() { return reinterpret_cast<std::byte*>(this + 1); }
+   const std::byte* Data() const { return reinterpret_cast<const std::byte*>(this + 1); }
+};
+static_assert(sizeof(ByteRingRecord) == 8);
+
+// Single producer single consumer ring of variable length records, written and read in place.
+// A record never wraps: if it doesn't fit before the end of the buffer, the rest is filled with a padding
+// record the consumer skips. Positions are byte counters that never wrap, capacity must be a power of two.
+// A record takes at most half of the capacity, so with padding it still fits once the ring drains.
+class ByteRing {
+public:
+   static constexpr uint32_t kAlignment = 8;
+
+   ByteRing(int capacity) : buffer(capacity / sizeof(uint64_t)), capacity(capacity) {
+      assert(std::has_single_bit((unsigned)capacity) && (unsigned)capacity >= 2 * kAlignment);
+   }
+
+   // Producer side, size bytes of payload to fill or nullptr if there is no room. Nothing is visible until Commit
+   std::byte* TryClaim(uint32_t type, uint32_t size) {
+      assert(type != ByteRingRecord::kPadding);
+      assert(size <= MaxPayloadSize() && "Record can't be claimed at every position.");
+      uint64_t recordSize = RecordSize(size);
+
+      uint64_t curTail = tail.load(std::memory_order::relaxed);
+      uint64_t toEnd = capacity - (curTail & (capacity - 1));
+      uint64_t needed = recordSize <= toEnd ? recordSize : toEnd + recordSize;
+
+      if (curTail + needed - headCached > capacity) {
+         headCached = head.load(std::memory_order::acquire);
+         if (curTail + needed - headCached > capacity) {
+            return nullptr;
+         }
+      }
+
+      if (recordSize > toEnd) {
+         ByteRingRecord* padding = RecordAt(curTail);
+         padding->size = uint32_t(toEnd - sizeof(ByteRingRecord));
+         padding->type = ByteRingRecord::kPadding;
+         curTail += toEnd;
+      }
+
+      ByteRingRecord* record = RecordAt(curTail);
+      record->size = size;
+      record->type = type;
+      claimedTail = curTail + recordSize;
+      return record->Data();
+   }
+
+   // Publishes the record from the last successful TryClaim
+   void Commit() {
+      tail.store(claimedTail, std::memory_order::release);
+   }
+
+   bool Write(uint32_t type, const void* data, uint32_t size) {
+      std::byte* payload = TryClaim(type, size);
+      if (!payload) {
+         return false;
+      }
+      std::memcpy(payload, data, size);
+      Commit();
+      return true;
+   }
+
+   // Consumer side, oldest record or nullptr if empty. Valid until Release
+   const ByteRingRecord* Peek() {
+      uint64_t curHead = head.load(std::memory_order::relaxed);
+      while (true) {
+         if (curHead == tailCached) {
+            tailCached = tail.load(std::memory_order::acquire);
+            if (curHead == tailCached) {
+               return nullptr;
+            }
+         }
+
+         const ByteRingRecord* record = RecordAt(curHead);
+         if (record->type != ByteRingRecord::kPadding) {
+            peekedHead = curHead + RecordSize(record->size);
+            return record;
+         }
+
+         // give the padding back right away, the producer may be waiting for it
+         curHead += RecordSize(record->size);
+         head.store(curHead, std::memory_order::release);
+      }
+   }
+
+   // Frees the record returned by the last successful Peek
+   void Release() {
+      head.store(peekedHead, std::memory_order::release);
+   }
+
+   bool WasEmpty() const {
+      return tail == head;
+   }
+
+   int Capacity() const {
+      return (int)capacity;
+   }
+
+   // Largest size for TryClaim and Write
+   uint32_t MaxPayloadSize() const {
+      return uint32_t(capacity / 2 - sizeof(ByteRingRecord));
+   }
+
+   static uint64_t RecordSize(uint32_t size) {
+      return (sizeof(ByteRingRecord) + size + kAlignment - 1) & ~uint64_t(kAlignment - 1);
+   }
+
+private:
+   std::vector<uint64_t> buffer; // 8 byte aligned storage
+   uint64_t capacity;
+
+   ALIGN_CACHE_LINE std::atomic<uint64_t> head = 0;
+   ALIGN_CACHE_LINE std::atomic<uint64_t> tail = 0;
+
+   // producer only
+   ALIGN_CACHE_LINE uint64_t headCached = 0;
+   uint64_t claimedTail = 0;
+
+   // consumer only
+   ALIGN_CACHE_LINE uint64_t tailCached = 0;
+   uint64_t peekedHead = 0;
+
+   ByteRingRecord* RecordAt(uint64_t position) {
+      return reinterpret_cast<ByteRingRecord*>(reinterpret_cast<std::byte*>(buffer.data()) + (position & (capacity - 1)));
+   }
+};
@@ -0,0 +1,4 @@
+#pragma once
+#include <new>
+
+#define ALIGN_CACHE_LINE alignas(std::hardware_destructive_interference_size)
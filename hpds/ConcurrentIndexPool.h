@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+#include "CacheLine.h"
+
+// Thread safe IndexPool. Free indices are kept in chains, a lock-free stack of chains has an ABA tag in the head word.
+// Threads allocating a lot use a ThreadCache (magazine): it takes and returns whole chains with one CAS,
+// between that Allocate/Free stay thread local.
+class ConcurrentIndexPool {
+public:
+   static constexpr int kMagazineSize = 32;
+
+   ConcurrentIndexPool(int capacity)
+      : capacity(capacity), next(std::make_unique<int[]>(capacity)), chainNext(std::make_unique<std::atomic<int>[]>(capacity)) {}
+
+   // -1 if exhausted. Indices sitting in other threads' caches don't count as available
+   int Allocate() {
+      int index = PopChain();
+      if (index >= 0) {
+         if (next[index] >= 0) {
+            PushChain(next[index]);
+         }
+         return index;
+      }
+
+      int count = 0;
+      int first = TakeFresh(1, count);
+      return count > 0 ? first : -1;
+   }
+
+   void Free(int index) {
+      assert(index >= 0 && index < capacity && "Invalid index to free.");
+      next[index] = -1;
+      PushChain(index);
+   }
+
+   int Capacity() const {
+      return capacity;
+   }
+
+   // Per thread magazine, not thread safe itself. Cached indices go back to the pool on destruction
+   class ThreadCache {
+   public:
+      explicit ThreadCache(ConcurrentIndexPool& pool) : pool(pool) {}
+      ThreadCache(const ThreadCache&) = delete;
+      ThreadCache& operator=(const ThreadCache&) = delete;
+      ~ThreadCache() { Flush(); }
+
+      // -1 if exhausted
+      int Allocate() {
+         if (count == 0 && !Refill()) {
+            return -1;
+         }
+         return indices[--count];
+      }
+
+      void Free(int index) {
+         assert(index >= 0 && index < pool.capacity && "Invalid index to free.");
+         if (count == kCacheSize) {
+            // keep half so alternating Allocate/Free at the boundary doesn't bounce chains
+            ReturnChain(kMagazineSize);
+         }
+         indices[count++] = index;
+      }
+
+      void Flush() {
+         if (count > 0) {
+            ReturnChain(count);
+         }
+      }
+
+   private:
+      static constexpr int kCacheSize = 2 * kMagazineSize;
+
+      ConcurrentIndexPool& pool;
+      int indices[kCacheSize];
+      int count = 0;
+
+      bool Refill() {
+         int index = pool.PopChain();
+         if (index >= 0) {
+            for (; index >= 0 && count < kCacheSize; index = pool.next[index]) {
+               indices[count++] = index;
+            }
+            assert(index < 0);
+            return true;
+         }
+
+         int fresh = 0;
+         int first = pool.TakeFresh(kMagazineSize, fresh);
+         for (int i = fresh - 1; i >= 0; --i) {
+            indices[count++] = first + i;
+         }
+         return count > 0;
+      }
+
+      // Links the top n cached indices into a chain and hands it to the pool
+      void ReturnChain(int n) {
+         int head = -1;
+         for (int i = 0; i < n; ++i) {
+            int index = indices[--count];
+            pool.next[index] = head;
+            head = index;
+         }
+         pool.PushChain(head);
+      }
+   };
+
+private:
+   int capacity;
+   std::unique_ptr<int[]> next; // link inside a chain, touched only by the chain's owner
+   std::unique_ptr<std::atomic<int>[]> chainNext; // link between chains in the stack, read racily by PopChain
+
+   // tag << 32 | (head index + 1), 0 is an empty stack
+   ALIGN_CACHE_LINE std::atomic<uint64_t> chains = 0;
+   ALIGN_CACHE_LINE std::atomic<int> nextFresh = 0;
+
+   static uint64_t Tagged(uint64_t head, int index) {
+      return ((head >> 32) + 1) << 32 | uint32_t(index + 1);
+   }
+
+   void PushChain(int head) {
+      uint64_t top = chains.load(std::memory_order::relaxed);
+      do {
+         chainNext[head].store(int(uint32_t(top)) - 1, std::memory_order::relaxed);
+      } while (!chains.compare_exchange_weak(top, Tagged(top, head), std::memory_order::release, std::memory_order::relaxed));
+   }
+
+   // Head of a whole chain or -1
+   int PopChain() {
+      uint64_t top = chains.load(std::memory_order::acquire);
+      while (uint32_t(top) != 0) {
+         int head = int(uint32_t(top)) - 1;
+         // stale if head was popped and pushed again meanwhile, then the tag makes CAS fail
+         int below = chainNext[head].load(std::memory_order::relaxed);
+         if (chains.compare_exchange_weak(top, Tagged(top, below), std::memory_order::acquire)) {
+            return head;
+         }
+      }
+      return -1;
+   }
+
+   // Never used indices, [first, first + count)
+   int TakeFresh(int wanted, int& count) {
+      if (nextFresh.load(std::memory_order::relaxed) >= capacity) {
+         count = 0;
+         return -1;
+      }
+      int first = nextFresh.fetch_add(wanted, std::memory_order::relaxed);
+      count = std::clamp(capacity - first, 0, wanted);
+      return first;
+   }
+};
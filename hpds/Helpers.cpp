@@ -1,5 +1,7 @@
 #include "Helpers.h"
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 #include <ranges>
 
@@ -80,3 +82,81 @@ std::vector<int> GenerateSequentialVector(int N) {
    std::vector<int> result(range.begin(), range.end());
    return result;
 }
+
+OrderFlowGenerator::OrderFlowGenerator(const OrderFlowConfig& config) : config(config), state(config.seed), mid(config.startMid) {}
+
+float OrderFlowGenerator::Uniform() {
+   return float(HashPcg(state)) / float(UINT_MAX);
+}
+
+float OrderFlowGenerator::Exponential(float mean) {
+   return -mean * std::log(std::max(1.f - Uniform(), 1e-7f));
+}
+
+OrderFlowEvent OrderFlowGenerator::Next() {
+   if (Uniform() < config.midMoveProbability) {
+      mid += Uniform() < 0.5f ? 1 : -1;
+   }
+
+   bool inBurst = burstLeft > 0;
+   if (inBurst) {
+      --burstLeft;
+   } else if (Uniform() < config.burstProbability) {
+      burstLeft = 1 + (int)Exponential(float(config.meanBurstLength));
+      burstIsBuy = Uniform() < 0.5f;
+   }
+
+   uint32_t gapNs = (uint32_t)Exponential(float(inBurst ? config.burstGapNs : config.calmGapNs));
+
+   float op = Uniform();
+   if (!inBurst && op < config.cancelShare + config.modifyShare && !liveOrders.empty()) {
+      // recent orders are canceled first
+      int index = (int)liveOrders.size() - 1 - std::min((int)liveOrders.size() - 1, (int)Exponential(32.f));
+      auto& [id, quantity] = liveOrders[index];
+
+      if (op < config.cancelShare || quantity == 1) {
+         OrderFlowEvent event{ OrderFlowEvent::Type::Cancel, false, false, 0, 0, id, gapNs };
+         liveOrders[index] = liveOrders.back();
+         liveOrders.pop_back();
+         return event;
+      }
+
+      quantity = 1 + int(Uniform() * float(quantity - 1));
+      return OrderFlowEvent{ OrderFlowEvent::Type::Modify, false, false, 0, quantity, id, gapNs };
+   }
+
+   OrderFlowEvent event = NextAdd();
+   if (inBurst) {
+      // bursts are one sided and take liquidity
+      event.isBuy = Uniform() < 0.8f ? burstIsBuy : !burstIsBuy;
+      event.aggressive = event.aggressive || Uniform() < config.aggressiveShare * 2.f;
+   }
+
+   int distance = 1 + (int)Exponential(event.aggressive ? config.meanDistanceTicks / 2.f : config.meanDistanceTicks - 1.f);
+   event.price = event.isBuy == event.aggressive ? mid + distance : mid - distance;
+   event.gapNs = gapNs;
+
+   if (!event.aggressive) {
+      liveOrders.emplace_back(event.orderId, event.quantity);
+   }
+   return event;
+}
+
+OrderFlowEvent OrderFlowGenerator::NextAdd() {
+   OrderFlowEvent event{};
+   event.type = OrderFlowEvent::Type::Add;
+   event.isBuy = Uniform() < 0.5f;
+   event.aggressive = Uniform() < config.aggressiveShare;
+   event.quantity = std::min(config.maxSize, int(float(config.minSize) * std::pow(std::max(1.f - Uniform(), 1e-7f), -1.f / config.sizeAlpha)));
+   event.orderId = nAdds++;
+   return event;
+}
+
+std::vector<OrderFlowEvent> GenerateOrderFlow(int count, const OrderFlowConfig& config) {
+   OrderFlowGenerator generator{ config };
+   std::vector<OrderFlowEvent> events(count);
+   for (auto& event : events) {
+      event = generator.Next();
+   }
+   return events;
+}
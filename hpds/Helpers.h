@@ -1,5 +1,8 @@
 #pragma once
 #include <chrono>
+#include <compare>
+#include <cstdint>
+#include <vector>
 
 uint32_t HashPcg(uint32_t& state);
 uint32_t RandPcg();
@@ -40,3 +43,66 @@ std::vector<int> GenerateRandomIntegers(int count, int minValue = 0, int maxValu
 std::vector<float> GenerateRandomDoubles(int count, float minValue = 0.f, float maxValue = 1000.f);
 
 std::vector<int> GenerateSequentialVector(int N);
+
+// Synthetic order flow: prices cluster around a drifting mid, sizes have a power-law tail,
+// cancels mostly hit recently added orders, arrivals come in bursts with more aggressive one sided flow.
+// Deterministic for a given seed.
+struct OrderFlowConfig {
+   uint32_t seed = 1;
+   int startMid = 100;
+   float midMoveProbability = 0.01f; // per event, mid moves one tick up or down
+   float meanDistanceTicks = 3.f;    // of passive orders from mid
+   float sizeAlpha = 1.5f;           // Pareto tail exponent, lower is heavier
+   int minSize = 1;
+   int maxSize = 1000;
+   float cancelShare = 0.3f;
+   float modifyShare = 0.05f;
+   float aggressiveShare = 0.1f;     // of adds, cross the mid
+   float burstProbability = 0.002f;  // per event, burst start
+   int meanBurstLength = 50;
+   int calmGapNs = 1000;             // mean time between events
+   int burstGapNs = 20;
+};
+
+struct OrderFlowEvent {
+   enum class Type : uint8_t {
+      Add,
+      Cancel,
+      Modify,
+   };
+
+   Type type;
+   bool isBuy;
+   bool aggressive;
+   int price;
+   int quantity; // add, modify (reduction)
+   int orderId;  // cancel, modify: index of the add in the flow, the id a book assigns on replay
+   uint32_t gapNs;
+
+   auto operator<=>(const OrderFlowEvent&) const = default;
+};
+
+class OrderFlowGenerator {
+public:
+   OrderFlowGenerator(const OrderFlowConfig& config = {});
+
+   OrderFlowEvent Next();
+
+   int Mid() const { return mid; }
+
+private:
+   OrderFlowConfig config;
+   uint32_t state;
+   int mid;
+   int nAdds = 0;
+   int burstLeft = 0;
+   bool burstIsBuy = false;
+   std::vector<std::pair<int, int>> liveOrders; // id, quantity of passive adds
+
+   float Uniform();
+   float Exponential(float mean);
+   OrderFlowEvent NextAdd();
+};
+
+// Pregenerated flow, keeps generation out of timed loops
+std::vector<OrderFlowEvent> GenerateOrderFlow(int count, const OrderFlowConfig& config = {});
@@ -26,9 +26,31 @@ public:
       freeIndices.push_back(index);
    }
 
+   // Frees everything, then first allocated indices are taken in one step
+   void Reset(int allocated = 0) {
+      assert(allocated <= capacity && "Invalid allocated count.");
+      nextIndex = allocated;
+      freeIndices.clear();
+   }
+
+   // Raises capacity, allocated indices stay valid
+   void Grow(int newCapacity) {
+      assert(newCapacity >= capacity && "Pool can't shrink.");
+      capacity = newCapacity;
+      freeIndices.reserve(capacity);
+   }
+
+   int Capacity() const {
+      return capacity;
+   }
+
    int Available() const {
       return capacity - nextIndex + (int)freeIndices.size();
    }
+
+   int Allocated() const {
+      return nextIndex - (int)freeIndices.size();
+   }
 private:
    int capacity;
    int nextIndex = 0;
@@ -0,0 +1,183 @@
+#include "Journal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool JournalWriter::Open(const char* path) {
+   Close();
+
+   file = std::fopen(path, "wb");
+   if (!file) {
+      return false;
+   }
+
+   JournalHeader header;
+   if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+      std::fclose(file);
+      file = nullptr;
+      return false;
+   }
+
+   stop = false;
+   failed = false;
+   thread = std::thread{ [this] { WriterLoop(); } };
+   return true;
+}
+
+bool JournalWriter::Close() {
+   if (!file) {
+      return !Failed();
+   }
+
+   stop.store(true, std::memory_order::release);
+   thread.join();
+
+   if (std::fclose(file) != 0) {
+      failed = true;
+   }
+   file = nullptr;
+   return !Failed();
+}
+
+void JournalWriter::WriterLoop() {
+   // Idle writer spins briefly, then sleeps with backoff up to kMaxIdleSleep so an open journal costs no cpu.
+   // Bounds how late a burst is picked up, the ring absorbs appends meanwhile
+   constexpr int kIdleSpins = 64;
+   constexpr auto kMinIdleSleep = std::chrono::microseconds{ 50 };
+   constexpr auto kMaxIdleSleep = std::chrono::milliseconds{ 1 };
+
+   std::vector<JournalRecord> batch;
+   batch.reserve(4096);
+   bool dirty = false;
+   int idle = 0;
+   auto idleSleep = kMinIdleSleep;
+
+   while (true) {
+      // read stop before draining, so records appended before Close are written
+      bool stopping = stop.load(std::memory_order::acquire);
+
+      while (batch.size() < batch.capacity()) {
+         auto record = ring.Pop();
+         if (!record) {
+            break;
+         }
+         batch.push_back(*record);
+      }
+
+      if (!batch.empty()) {
+         // after a failure records are still drained, so Append never blocks on a dead writer
+         if (!Failed() && std::fwrite(batch.data(), sizeof(JournalRecord), batch.size(), file) != batch.size()) {
+            failed = true;
+         }
+         batch.clear();
+         dirty = true;
+         idle = 0;
+         idleSleep = kMinIdleSleep;
+         continue;
+      }
+
+      // ring is drained, hand buffered records to the OS so errors show up without waiting for Close
+      if (dirty) {
+         if (!Failed() && std::fflush(file) != 0) {
+            failed = true;
+         }
+         dirty = false;
+      }
+
+      if (stopping) {
+         return;
+      }
+      if (idle < kIdleSpins) {
+         ++idle;
+         std::this_thread::yield();
+      } else {
+         std::this_thread::sleep_for(idleSleep);
+         idleSleep = std::min(idleSleep * 2, std::chrono::duration_cast<std::chrono::microseconds>(kMaxIdleSleep));
+      }
+   }
+}
+
+bool JournalReader::Open(const char* path) {
+   Close();
+
+#ifdef _WIN32
+   HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+   if (file == INVALID_HANDLE_VALUE) {
+      return false;
+   }
+
+   LARGE_INTEGER fileSize{};
+   GetFileSizeEx(file, &fileSize);
+   size_t size = (size_t)fileSize.QuadPart;
+
+   HANDLE fileMapping = size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+   CloseHandle(file);
+   if (!fileMapping) {
+      return false;
+   }
+
+   void* data = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+   CloseHandle(fileMapping);
+   if (!data) {
+      return false;
+   }
+#else
+   int fd = open(path, O_RDONLY);
+   if (fd < 0) {
+      return false;
+   }
+
+   struct stat fileStat{};
+   fstat(fd, &fileStat);
+   size_t size = (size_t)fileStat.st_size;
+
+   void* data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+   close(fd);
+   if (data == MAP_FAILED) {
+      return false;
+   }
+   madvise(data, size, MADV_SEQUENTIAL);
+#endif
+
+   mapping = data;
+   mappingSize = size;
+
+   const auto* header = static_cast<const JournalHeader*>(data);
+   if (size < sizeof(JournalHeader) || header->magic != JournalHeader::kMagic
+      || header->version != JournalHeader::kVersion || header->recordSize != sizeof(JournalRecord)) {
+      Close();
+      return false;
+   }
+
+   // partially written tail record is ignored
+   size_t nRecords = (size - sizeof(JournalHeader)) / sizeof(JournalRecord);
+   records = { reinterpret_cast<const JournalRecord*>(header + 1), nRecords };
+   return true;
+}
+
+void JournalReader::Close() {
+   if (!mapping) {
+      return;
+   }
+
+#ifdef _WIN32
+   UnmapViewOfFile(mapping);
+#else
+   munmap(mapping, mappingSize);
+#endif
+
+   mapping = nullptr;
+   mappingSize = 0;
+   records = {};
+}
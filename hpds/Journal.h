@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <thread>
+
+#include "OrderBook.h"
+#include "RingBuffer.h"
+
+// Fixed size binary record of order flow, file is JournalHeader followed by records
+struct JournalRecord {
+   enum class Type : uint8_t {
+      Add,
+      Cancel,
+      Modify,
+   };
+
+   Type type;
+   uint8_t isBuy;
+   OrderType orderType;
+   uint8_t reserved = 0;
+   int32_t price;
+   int32_t quantity; // add, modify
+   int32_t orderId;  // cancel, modify
+
+   static JournalRecord Add(const OrderBookTypes::OrderRequest& request) {
+      return { Type::Add, request.isBuy, request.type, 0, request.price, request.quantity, -1 };
+   }
+
+   static JournalRecord Cancel(OrderBookTypes::OrderId id) {
+      return { Type::Cancel, 0, OrderType::Limit, 0, 0, 0, id };
+   }
+
+   static JournalRecord Modify(OrderBookTypes::OrderId id, OrderBookTypes::Quantity quantity) {
+      return { Type::Modify, 0, OrderType::Limit, 0, 0, quantity, id };
+   }
+};
+static_assert(sizeof(JournalRecord) == 16);
+
+struct JournalHeader {
+   static constexpr uint64_t kMagic = 0x4c4e524a53445048; // "HPDSJRNL"
+   static constexpr uint32_t kVersion = 1;
+
+   uint64_t magic = kMagic;
+   uint32_t version = kVersion;
+   uint32_t recordSize = sizeof(JournalRecord);
+};
+static_assert(sizeof(JournalHeader) == 16);
+
+// Append from one (matching) thread, records are handed to a background thread through a ring and written in batches.
+// Append waits only when the ring is full, i.e. disk can't keep up.
+// A failed write or flush (disk full, I/O error) is sticky: the journal is truncated from there, Append and Close report it.
+class JournalWriter {
+public:
+   JournalWriter(int ringCapacity = 1 << 16) : ring(ringCapacity) {}
+   ~JournalWriter() { Close(); }
+
+   bool Open(const char* path);
+   // false if any write failed since Open
+   bool Close();
+
+   // false if the writer is not open or a write has failed, the record is dropped then
+   bool Append(const JournalRecord& record) {
+      if (!file || Failed()) {
+         return false;
+      }
+      while (!ring.Push(record)) {
+         std::this_thread::yield();
+      }
+      return true;
+   }
+
+   bool Failed() const {
+      return failed.load(std::memory_order::relaxed);
+   }
+
+private:
+   RingBuffer<JournalRecord> ring;
+   std::FILE* file = nullptr;
+   std::thread thread;
+   std::atomic<bool> stop = false;
+   std::atomic<bool> failed = false;
+
+   void WriterLoop();
+};
+
+// Memory mapped journal, records are read in place
+class JournalReader {
+public:
+   JournalReader() = default;
+   JournalReader(const JournalReader&) = delete;
+   JournalReader& operator=(const JournalReader&) = delete;
+   ~JournalReader() { Close(); }
+
+   // false if file can't be mapped or header doesn't match
+   bool Open(const char* path);
+   void Close();
+
+   std::span<const JournalRecord> Records() const {
+      return records;
+   }
+
+private:
+   void* mapping = nullptr;
+   size_t mappingSize = 0;
+   std::span<const JournalRecord> records;
+};
+
+// Feeds records into the book, order ids in the journal are the ones the book assigns during replay
+template<typename BookType>
+void ReplayJournal(std::span<const JournalRecord> records, BookType& book) {
+   for (const JournalRecord& record : records) {
+      switch (record.type) {
+         case JournalRecord::Type::Add:
+            book.AddOrder(typename BookType::OrderRequest{ record.price, record.quantity, record.isBuy != 0, record.orderType });
+            break;
+         case JournalRecord::Type::Cancel:
+            book.CancelOrder(record.orderId);
+            break;
+         case JournalRecord::Type::Modify:
+            book.ModifyOrder(record.orderId, record.quantity);
+            break;
+      }
+   }
+}
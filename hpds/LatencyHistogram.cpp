@@ -0,0 +1,57 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+   uint64_t count = Count();
+   if (count == 0) {
+      return 0;
+   }
+
+   percentile = std::clamp(percentile, 0.0, 100.0);
+   uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(percentile / 100.0 * double(count)));
+
+   uint64_t seen = 0;
+   for (int i = 0; i < kBuckets; ++i) {
+      seen += counts[i].load(std::memory_order::relaxed);
+      if (seen >= rank) {
+         return std::min(BucketHighestValue(i), Max());
+      }
+   }
+   return Max();
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+   for (int i = 0; i < kBuckets; ++i) {
+      Increment(counts[i], other.counts[i].load(std::memory_order::relaxed));
+   }
+   Increment(totalCount, other.Count());
+   Increment(totalSum, other.totalSum.load(std::memory_order::relaxed));
+   maxValue.store(std::max(Max(), other.Max()), std::memory_order::relaxed);
+}
+
+void LatencyHistogram::Reset() {
+   for (auto& count : counts) {
+      count.store(0, std::memory_order::relaxed);
+   }
+   totalCount.store(0, std::memory_order::relaxed);
+   totalSum.store(0, std::memory_order::relaxed);
+   maxValue.store(0, std::memory_order::relaxed);
+}
+
+double TscTicksPerNanosecond() {
+   static const double ticksPerNanosecond = [] {
+      auto start = std::chrono::steady_clock::now();
+      uint64_t startTicks = ReadTsc();
+
+      std::chrono::nanoseconds elapsed;
+      do {
+         elapsed = std::chrono::steady_clock::now() - start;
+      } while (elapsed < std::chrono::milliseconds(10));
+
+      return double(ReadTsc() - startTicks) / double(elapsed.count());
+   }();
+   return ticksPerNanosecond;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <immintrin.h>
+
+// Log-linear histogram (HDR style) of non-negative values, e.g. latency in TSC ticks.
+// Values below 128 are exact, above each power of two is split into 64 buckets, so relative error is under 1.6%.
+// Fixed storage, no allocations. One writer per histogram, any thread may read concurrently.
+// For several writers use a histogram per thread and Merge them.
+class LatencyHistogram {
+public:
+   static constexpr int kSubBucketBits = 7;
+   static constexpr int kSubBuckets = 1 << kSubBucketBits;
+   static constexpr int kHalfSubBuckets = kSubBuckets / 2;
+   static constexpr int kBuckets = kSubBuckets + (64 - kSubBucketBits) * kHalfSubBuckets;
+
+   void Record(uint64_t value) {
+      Increment(counts[BucketIndex(value)], 1);
+      Increment(totalCount, 1);
+      Increment(totalSum, value);
+      if (value > maxValue.load(std::memory_order::relaxed)) {
+         maxValue.store(value, std::memory_order::relaxed);
+      }
+   }
+
+   uint64_t Count() const {
+      return totalCount.load(std::memory_order::relaxed);
+   }
+
+   uint64_t Max() const {
+      return maxValue.load(std::memory_order::relaxed);
+   }
+
+   double Mean() const {
+      uint64_t count = Count();
+      return count ? double(totalSum.load(std::memory_order::relaxed)) / double(count) : 0.0;
+   }
+
+   // Highest value equivalent to the bucket holding the percentile (0 - 100), clamped by Max
+   uint64_t ValueAtPercentile(double percentile) const;
+
+   // Not thread safe with writers of either histogram
+   void Merge(const LatencyHistogram& other);
+   void Reset();
+
+   static int BucketIndex(uint64_t value) {
+      if (value < kSubBuckets) {
+         return (int)value;
+      }
+      int shift = std::bit_width(value) - kSubBucketBits; // >= 1
+      int subBucket = int(value >> shift) - kHalfSubBuckets; // [0, kHalfSubBuckets)
+      return kSubBuckets + (shift - 1) * kHalfSubBuckets + subBucket;
+   }
+
+   static uint64_t BucketHighestValue(int index) {
+      if (index < kSubBuckets) {
+         return (uint64_t)index;
+      }
+      int shift = (index - kSubBuckets) / kHalfSubBuckets + 1;
+      uint64_t subBucket = (index - kSubBuckets) % kHalfSubBuckets + kHalfSubBuckets;
+      return ((subBucket + 1) << shift) - 1;
+   }
+
+private:
+   std::array<std::atomic<uint64_t>, kBuckets> counts{};
+   std::atomic<uint64_t> totalCount = 0;
+   std::atomic<uint64_t> totalSum = 0;
+   std::atomic<uint64_t> maxValue = 0;
+
+   // single writer, plain add instead of locked read-modify-write
+   static void Increment(std::atomic<uint64_t>& value, uint64_t delta) {
+      value.store(value.load(std::memory_order::relaxed) + delta, std::memory_order::relaxed);
+   }
+};
+
+// Cheap timestamp for latency measurement, invariant TSC is synchronized between cores
+inline uint64_t ReadTsc() {
+   return __rdtsc();
+}
+
+// Calibrated once against steady clock
+double TscTicksPerNanosecond();
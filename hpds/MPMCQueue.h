@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <immintrin.h>
+#include <optional>
+#include <vector>
+
+#include "CacheLine.h"
+
+// Bounded multi producer multi consumer queue, https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// Every slot has a sequence number telling whose turn it is: slot i of lap k is free for the producer of position
+// k * capacity + i when sequence == position, and ready for the consumer when sequence == position + 1.
+// Producers and consumers only contend on their own position counter, capacity must be a power of two.
+template<typename T>
+class MPMCQueue {
+public:
+   MPMCQueue(int capacity) : slots(capacity), mask(capacity - 1) {
+      assert(std::has_single_bit((unsigned)capacity));
+      for (int i = 0; i < capacity; ++i) {
+         slots[i].sequence.store(i, std::memory_order::relaxed);
+      }
+   }
+
+   bool TryPush(const T& data) {
+      uint64_t pos = enqueuePos.load(std::memory_order::relaxed);
+      Slot* slot;
+      while (true) {
+         slot = &slots[pos & mask];
+         uint64_t sequence = slot->sequence.load(std::memory_order::acquire);
+         int64_t diff = int64_t(sequence - pos);
+         if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order::relaxed)) {
+               break;
+            }
+         } else if (diff < 0) {
+            // consumer of the previous lap didn't take it yet
+            return false;
+         } else {
+            pos = enqueuePos.load(std::memory_order::relaxed);
+         }
+      }
+
+      slot->data = data;
+      slot->sequence.store(pos + 1, std::memory_order::release);
+      return true;
+   }
+
+   std::optional<T> TryPop() {
+      uint64_t pos = dequeuePos.load(std::memory_order::relaxed);
+      Slot* slot;
+      while (true) {
+         slot = &slots[pos & mask];
+         uint64_t sequence = slot->sequence.load(std::memory_order::acquire);
+         int64_t diff = int64_t(sequence - (pos + 1));
+         if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order::relaxed)) {
+               break;
+            }
+         } else if (diff < 0) {
+            return {};
+         } else {
+            pos = dequeuePos.load(std::memory_order::relaxed);
+         }
+      }
+
+      std::optional<T> data = std::move(slot->data);
+      // free for the producer of the next lap
+      slot->sequence.store(pos + mask + 1, std::memory_order::release);
+      return data;
+   }
+
+   void Push(const T& data) {
+      while (!TryPush(data)) {
+         _mm_pause();
+      }
+   }
+
+   T PopWait() {
+      while (true) {
+         if (auto data = TryPop()) {
+            return std::move(*data);
+         }
+         _mm_pause();
+      }
+   }
+
+   int Capacity() const {
+      return (int)slots.size();
+   }
+
+private:
+   // slot per cache line, neighbour slots are usually touched by different threads
+   struct Slot {
+      ALIGN_CACHE_LINE std::atomic<uint64_t> sequence;
+      T data;
+   };
+
+   std::vector<Slot> slots;
+   uint64_t mask;
+
+   ALIGN_CACHE_LINE std::atomic<uint64_t> enqueuePos = 0;
+   ALIGN_CACHE_LINE std::atomic<uint64_t> dequeuePos = 0;
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "CacheLine.h"
+
+// Nodes for MPSCQueue, taken by any producer and given back by the consumer, no allocation in steady state.
+// Lock-free stack of node indices with an ABA tag in the upper half of the head word.
+// Grows by chunks under a mutex, chunks are never freed or moved until the pool is destroyed.
+template<typename Node>
+class NodePool {
+public:
+   static constexpr uint32_t kChunkSize = 1024;
+   static constexpr uint32_t kMaxChunks = 1 << 16;
+
+   NodePool() : chunks(std::make_unique<std::unique_ptr<Node[]>[]>(kMaxChunks)) {}
+
+   Node* Allocate() {
+      while (true) {
+         uint64_t head = freeHead.load(std::memory_order::acquire);
+         uint32_t index = uint32_t(head);
+         if (index == 0) {
+            Grow();
+            continue;
+         }
+
+         Node* node = At(index - 1);
+         // may already be taken and changed by another thread, then CAS fails on the tag
+         uint32_t next = node->freeNext.load(std::memory_order::relaxed);
+         if (freeHead.compare_exchange_weak(head, Tagged(head, next), std::memory_order::acquire)) {
+            return node;
+         }
+      }
+   }
+
+   void Free(Node* node) {
+      Push(node, node);
+   }
+
+   // Makes sure at least count nodes were created
+   void Reserve(uint32_t count) {
+      while (chunkCount.load(std::memory_order::relaxed) * kChunkSize < count) {
+         AddChunk();
+      }
+   }
+
+private:
+   std::unique_ptr<std::unique_ptr<Node[]>[]> chunks;
+   std::atomic<uint32_t> chunkCount = 0;
+   std::mutex growMutex;
+
+   // tag << 32 | (index + 1), 0 is an empty list
+   ALIGN_CACHE_LINE std::atomic<uint64_t> freeHead = 0;
+
+   static uint64_t Tagged(uint64_t head, uint32_t next) {
+      return ((head >> 32) + 1) << 32 | next;
+   }
+
+   Node* At(uint32_t index) const {
+      return &chunks[index / kChunkSize][index % kChunkSize];
+   }
+
+   // Links first .. last (already chained through freeNext) in front of the list
+   void Push(Node* first, Node* last) {
+      uint64_t head = freeHead.load(std::memory_order::relaxed);
+      do {
+         last->freeNext.store(uint32_t(head), std::memory_order::relaxed);
+      } while (!freeHead.compare_exchange_weak(head, Tagged(head, first->poolIndex + 1), std::memory_order::release));
+   }
+
+   void Grow() {
+      std::lock_guard lock{ growMutex };
+      // someone else grew or freed nodes meanwhile
+      if (uint32_t(freeHead.load(std::memory_order::acquire)) == 0) {
+         AddChunk();
+      }
+   }
+
+   void AddChunk() {
+      uint32_t chunk = chunkCount.load(std::memory_order::relaxed);
+      if (chunk == kMaxChunks) {
+         std::abort();
+      }
+
+      chunks[chunk] = std::make_unique<Node[]>(kChunkSize);
+      Node* nodes = chunks[chunk].get();
+      for (uint32_t i = 0; i < kChunkSize; ++i) {
+         nodes[i].poolIndex = chunk * kChunkSize + i;
+         nodes[i].freeNext.store(nodes[i].poolIndex + 2, std::memory_order::relaxed);
+      }
+      chunkCount.store(chunk + 1, std::memory_order::relaxed);
+
+      // release in Push publishes the chunk pointer to producers reading the list
+      Push(&nodes[0], &nodes[kChunkSize - 1]);
+   }
+};
+
+// Unbounded multi producer single consumer queue, https://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+// Producers link a node with one atomic exchange (plus a CAS to take the node from the pool).
+// Consumer is wait-free, it may see the queue empty for a moment while a producer is between exchange and link.
+template<typename T>
+class MPSCQueue {
+public:
+   MPSCQueue(uint32_t reserve = NodePool<Node>::kChunkSize) {
+      pool.Reserve(reserve);
+      Node* stub = pool.Allocate();
+      stub->next.store(nullptr, std::memory_order::relaxed);
+      head.store(stub, std::memory_order::relaxed);
+      tail = stub;
+   }
+
+   void Push(const T& data) {
+      Node* node = pool.Allocate();
+      node->data = data;
+      node->next.store(nullptr, std::memory_order::relaxed);
+
+      Node* prev = head.exchange(node, std::memory_order::acq_rel);
+      prev->next.store(node, std::memory_order::release);
+   }
+
+   // Consumer only
+   std::optional<T> Pop() {
+      Node* next = tail->next.load(std::memory_order::acquire);
+      if (!next) {
+         return {};
+      }
+
+      // next becomes the stub, the old one goes back to the pool
+      std::optional<T> data = std::move(next->data);
+      pool.Free(tail);
+      tail = next;
+      return data;
+   }
+
+   // Consumer only
+   bool Empty() const {
+      return !tail->next.load(std::memory_order::acquire);
+   }
+
+private:
+   struct Node {
+      std::atomic<Node*> next = nullptr;
+      std::atomic<uint32_t> freeNext = 0;
+      uint32_t poolIndex = 0;
+      T data{};
+   };
+
+   NodePool<Node> pool;
+
+   ALIGN_CACHE_LINE std::atomic<Node*> head;
+   ALIGN_CACHE_LINE Node* tail;
+};
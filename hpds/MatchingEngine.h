@@ -0,0 +1,173 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <immintrin.h>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "OrderBook.h"
+#include "RingBuffer.h"
+
+// Many order books partitioned across worker threads, symbol -> worker is symbol % nWorkers.
+// Orders go to the worker through its inbound SPSC ring, results come back through its outbound ring.
+// Submit must be called from one thread, PollResults and Stop from one thread (can be the same one),
+// Stop must not run concurrently with Submit. Results of one symbol come back in submit order.
+// WaitStrategy decides how a worker idles on an empty inbound ring, see WaitStrategy.h.
+// Default parks idle workers, BusySpinWait trades a core per worker for the lowest latency.
+template<typename BookType = LadderOrderBook, typename WaitStrategy = ParkWait>
+class MatchingEngine {
+public:
+   using SymbolId = int;
+
+   struct EngineOrder {
+      SymbolId symbol;
+      typename BookType::OrderRequest request;
+   };
+
+   struct EngineResult {
+      SymbolId symbol;
+      typename BookType::OrderResult result;
+   };
+
+   // Books start small and grow with resting orders, so thousands of symbols don't pin memory up front
+   MatchingEngine(int nWorkers, int nSymbols, int ringCapacity = 4096, int reservedOrdersPerBook = 1 << 12) {
+      Init(nWorkers, nSymbols, ringCapacity, [&](SymbolId) { return reservedOrdersPerBook; });
+   }
+
+   // Per symbol hint, reservedOrders[symbol] orders are preallocated in its book
+   MatchingEngine(int nWorkers, std::span<const int> reservedOrders, int ringCapacity = 4096) {
+      Init(nWorkers, (int)reservedOrders.size(), ringCapacity, [&](SymbolId symbol) { return reservedOrders[symbol]; });
+   }
+
+   ~MatchingEngine() {
+      Stop();
+   }
+
+   // onThreadStart runs first on every worker thread, e.g. start barrier
+   void Start(std::function<void()> onThreadStart = {}) {
+      assert(!running);
+      running = true;
+
+      for (auto& worker : workers) {
+         worker->finished = false;
+         worker->thread = std::thread{ [this, &worker = *worker, onThreadStart] {
+            if (onThreadStart) {
+               onThreadStart();
+            }
+            WorkerLoop(worker);
+         } };
+      }
+   }
+
+   // Worker finishes already submitted orders before exit.
+   // Poll all results before Stop, the ones left in outbound rings are dropped.
+   void Stop() {
+      if (!running) {
+         return;
+      }
+
+      for (auto& worker : workers) {
+         // stop order wakes a parked worker, it is queued after all submitted orders.
+         // worker could wait for space in outbound ring meanwhile
+         while (!worker->inbound.Push(EngineOrder{ kStopSymbol, {} })) {
+            while (worker->outbound.Pop());
+            _mm_pause();
+         }
+         while (!worker->finished.load(std::memory_order::acquire)) {
+            while (worker->outbound.Pop());
+            _mm_pause();
+         }
+         worker->thread.join();
+      }
+      running = false;
+   }
+
+   // false if inbound ring of the symbol worker is full, drain results and retry.
+   // symbol must be in [0, Symbols()), negative one would be taken for the stop order
+   bool Submit(SymbolId symbol, const typename BookType::OrderRequest& request) {
+      assert(symbol >= 0 && symbol < nSymbols);
+      return workers[WorkerOf(symbol)]->inbound.Push(EngineOrder{ symbol, request });
+   }
+
+   // fn(const EngineResult&) for every available result, returns handled count
+   template<typename F>
+   int PollResults(F&& fn) {
+      int count = 0;
+      for (auto& worker : workers) {
+         while (auto result = worker->outbound.Pop()) {
+            fn(*result);
+            ++count;
+         }
+      }
+      return count;
+   }
+
+   int WorkerOf(SymbolId symbol) const {
+      return symbol % (int)workers.size();
+   }
+
+   int Workers() const {
+      return (int)workers.size();
+   }
+
+   int Symbols() const {
+      return nSymbols;
+   }
+
+private:
+   static constexpr SymbolId kStopSymbol = -1;
+
+   struct Worker {
+      RingBuffer<EngineOrder, false, WaitStrategy> inbound;
+      RingBuffer<EngineResult> outbound;
+      std::vector<std::unique_ptr<BookType>> books; // symbols of this worker, symbol / nWorkers
+      std::thread thread;
+      std::atomic<bool> finished = false;
+
+      Worker(int ringCapacity) : inbound(ringCapacity), outbound(ringCapacity) {}
+   };
+
+   std::vector<std::unique_ptr<Worker>> workers;
+   int nSymbols = 0;
+   bool running = false;
+
+   template<typename ReservedOf>
+   void Init(int nWorkers, int nSymbols, int ringCapacity, ReservedOf&& reservedOf) {
+      assert(nWorkers > 0 && nSymbols > 0);
+      this->nSymbols = nSymbols;
+
+      for (int i = 0; i < nWorkers; ++i) {
+         workers.push_back(std::make_unique<Worker>(ringCapacity));
+      }
+      for (SymbolId symbol = 0; symbol < nSymbols; ++symbol) {
+         workers[WorkerOf(symbol)]->books.push_back(std::make_unique<BookType>(reservedOf(symbol)));
+      }
+   }
+
+   void WorkerLoop(Worker& worker) {
+      int nWorkers = (int)workers.size();
+
+      while (true) {
+         EngineOrder order = worker.inbound.PopWait();
+         if (order.symbol == kStopSymbol) {
+            worker.finished.store(true, std::memory_order::release);
+            return;
+         }
+
+         BookType& book = *worker.books[order.symbol / nWorkers];
+         EngineResult result{ order.symbol, book.AddOrder(order.request) };
+
+         // full outbound ring means the poller is behind, back off and give the core away
+         for (int iteration = 0; !worker.outbound.Push(result); ++iteration) {
+            if (iteration < YieldWait::kSpins) {
+               _mm_pause();
+            } else {
+               std::this_thread::yield();
+            }
+         }
+      }
+   }
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Set of indices in [0, size) as two level bitmap: bit per index and summary bit per non-zero word.
+// Next/previous set index is a couple of tzcnt/lzcnt, summary words are scanned 4 at a time with AVX2.
+// One summary word covers 4096 indices.
+class OccupancyBitmap {
+public:
+   OccupancyBitmap(int size = 0) {
+      Resize(size);
+   }
+
+   // Clears all bits
+   void Resize(int size) {
+      this->size = size;
+      words.assign((size + 63) / 64, 0);
+      // padded to AVX2 width, padding stays zero
+      summary.assign(((int)words.size() + 63) / 64 + 3, 0);
+   }
+
+   int Size() const {
+      return size;
+   }
+
+   bool Test(int index) const {
+      return words[index >> 6] >> (index & 63) & 1;
+   }
+
+   void Set(int index) {
+      int w = index >> 6;
+      words[w] |= 1ull << (index & 63);
+      summary[w >> 6] |= 1ull << (w & 63);
+   }
+
+   void Clear(int index) {
+      int w = index >> 6;
+      words[w] &= ~(1ull << (index & 63));
+      if (words[w] == 0) {
+         summary[w >> 6] &= ~(1ull << (w & 63));
+      }
+   }
+
+   // Smallest set index >= from, -1 if none
+   int NextSet(int from) const {
+      if (from >= size) {
+         return -1;
+      }
+
+      int w = from >> 6;
+      uint64_t bits = words[w] & (~0ull << (from & 63));
+      if (bits) {
+         return w * 64 + std::countr_zero(bits);
+      }
+
+      ++w;
+      int s = w >> 6;
+      if (w < (int)words.size()) {
+         uint64_t wordBits = summary[s] & (~0ull << (w & 63));
+         if (wordBits) {
+            w = s * 64 + std::countr_zero(wordBits);
+            return w * 64 + std::countr_zero(words[w]);
+         }
+      }
+
+      s = NextNonZeroSummary(s + 1);
+      if (s < 0) {
+         return -1;
+      }
+      w = s * 64 + std::countr_zero(summary[s]);
+      return w * 64 + std::countr_zero(words[w]);
+   }
+
+   // Largest set index <= from, -1 if none
+   int PrevSet(int from) const {
+      if (from < 0) {
+         return -1;
+      }
+
+      int w = from >> 6;
+      uint64_t bits = words[w] & (~0ull >> (63 - (from & 63)));
+      if (bits) {
+         return w * 64 + 63 - std::countl_zero(bits);
+      }
+
+      --w;
+      if (w < 0) {
+         return -1;
+      }
+      int s = w >> 6;
+      uint64_t wordBits = summary[s] & (~0ull >> (63 - (w & 63)));
+      if (wordBits) {
+         w = s * 64 + 63 - std::countl_zero(wordBits);
+         return w * 64 + 63 - std::countl_zero(words[w]);
+      }
+
+      s = PrevNonZeroSummary(s - 1);
+      if (s < 0) {
+         return -1;
+      }
+      w = s * 64 + 63 - std::countl_zero(summary[s]);
+      return w * 64 + 63 - std::countl_zero(words[w]);
+   }
+
+private:
+   int size = 0;
+   std::vector<uint64_t> words;
+   std::vector<uint64_t> summary;
+
+   int NextNonZeroSummary(int s) const {
+      int end = (int)summary.size();
+#ifdef __AVX2__
+      for (; s + 4 <= end; s += 4) {
+         __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(summary.data() + s));
+         if (!_mm256_testz_si256(v, v)) {
+            break;
+         }
+      }
+#endif
+      for (; s < end; ++s) {
+         if (summary[s]) {
+            return s;
+         }
+      }
+      return -1;
+   }
+
+   int PrevNonZeroSummary(int s) const {
+#ifdef __AVX2__
+      for (; s >= 3; s -= 4) {
+         __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(summary.data() + s - 3));
+         if (!_mm256_testz_si256(v, v)) {
+            break;
+         }
+      }
+#endif
+      for (; s >= 0; --s) {
+         if (summary[s]) {
+            return s;
+         }
+      }
+      return -1;
+   }
+};
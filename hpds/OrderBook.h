@@ -1,11 +1,31 @@
 #pragma once
-#include <map>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
 
-class OrderBook {
-public:
-   using OrderId = int;
-   using Price = int;
-   using Quantity = int;
+#include "IndexPool.h"
+#include "OrderBookPolicies.h"
+
+// One enum for every book instantiation, the journal stores it as is
+enum class OrderType : uint8_t {
+   Limit,             // rest unfilled part in the book
+   ImmediateOrCancel, // drop unfilled part
+   FillOrKill,        // fill completely or do nothing
+   Market,            // immediate or cancel at any price, price is ignored
+};
+
+template<typename OrderIdT, typename PriceT, typename QuantityT>
+struct BasicOrderBookTypes {
+   using OrderId = OrderIdT;
+   using Price = PriceT;
+   using Quantity = QuantityT;
+   using OrderType = ::OrderType;
 
    struct LevelInfo {
       Price price;
@@ -19,12 +39,72 @@ public:
       auto operator<=>(const TradeResult&) const = default;
    };
 
+   // Execution of a resting (maker) order against an incoming (taker) order, at the maker price
+   struct Fill {
+      OrderId makerId;
+      OrderId takerId;
+      Price price;
+      Quantity quantity;
+
+      auto operator<=>(const Fill&) const = default;
+   };
+
+   // Default fill sink, fill reporting compiles away
+   struct NullFillSink {
+      void operator()(const Fill&) const {}
+   };
+
+   // Aggregated level after change, zero quantity means level is gone
+   struct LevelUpdate {
+      Price price;
+      Quantity quantity;
+      bool isBuy;
+
+      auto operator<=>(const LevelUpdate&) const = default;
+   };
+
+   struct OrderRequest {
+      Price price;
+      Quantity quantity;
+      bool isBuy;
+      OrderType type = OrderType::Limit;
+   };
+
    struct OrderResult {
       OrderId id;
       TradeResult tradeResult;
 
       auto operator<=>(const OrderResult&) const = default;
    };
+};
+
+using OrderBookTypes = BasicOrderBookTypes<int, int, int>;
+
+// Storage and numeric types come from Policy, see OrderBookPolicies.h. Policy provides:
+// OrderId, Price, Quantity, Levels<Price, Level, Compare>, LevelQueue<OrderId>, IdIndex<OrderId>.
+template<typename Policy = DefaultOrderBookPolicy>
+class BasicOrderBook : public BasicOrderBookTypes<typename Policy::OrderId, typename Policy::Price, typename Policy::Quantity> {
+   using Types = BasicOrderBookTypes<typename Policy::OrderId, typename Policy::Price, typename Policy::Quantity>;
+
+public:
+   using typename Types::OrderId;
+   using typename Types::Price;
+   using typename Types::Quantity;
+   using typename Types::LevelInfo;
+   using typename Types::TradeResult;
+   using typename Types::Fill;
+   using typename Types::NullFillSink;
+   using typename Types::LevelUpdate;
+   using typename Types::OrderRequest;
+   using typename Types::OrderResult;
+
+   // Order slab is preallocated for reservedOrders resting orders, no allocations on the hot path until
+   // more orders rest, then slab and pool double. Pass a large value for books expected to hold many orders
+   BasicOrderBook(int reservedOrders = 1 << 12) : orderPool(reservedOrders) {
+      orders.reserve(reservedOrders);
+      idIndex.ReserveIds(reservedOrders);
+      changedLevels.reserve(256);
+   }
 
    OrderResult AddSellOrder(Price price, Quantity quantity) {
       return AddOrder(price, quantity, false);
@@ -34,86 +114,581 @@ public:
       return AddOrder(price, quantity, true);
    }
 
-   OrderResult AddOrder(Price price, Quantity quantity, bool isBuy) {
-      OrderId id = GetNextOrderId();
-      orderToPriceMap[id] = std::make_pair(price, isBuy);
+   // onFill is called for every fill: void(const Fill&)
+   template<typename FillSink = NullFillSink>
+   OrderResult AddOrder(Price price, Quantity quantity, bool isBuy, FillSink&& onFill = {}) {
+      return AddOrder(OrderRequest{ price, quantity, isBuy }, onFill);
+   }
+
+   // Incoming order is matched against the opposite side directly, only unfilled part of a limit order is stored.
+   // Fully filled orders are counted in canceledOrders, including the incoming one.
+   template<typename FillSink = NullFillSink>
+   OrderResult AddOrder(const OrderRequest& request, FillSink&& onFill = {}) {
+      ReserveOrders(1);
+      return trackLevelChanges ? AddReserved<true>(request, onFill) : AddReserved<false>(request, onFill);
+   }
+
+   // Results are identical to AddOrder one by one: later orders of a batch may trade against earlier ones.
+   // Slab, pool and id index grow for the whole batch up front. Limit orders which can't cross rest without
+   // matching: best opposite prices are cached over the batch and refreshed only after a matching order,
+   // a run of orders resting on the same level looks it up and marks it changed once.
+   template<typename FillSink = NullFillSink>
+   void AddOrders(std::span<const OrderRequest> requests, std::span<OrderResult> results, FillSink&& onFill = {}) {
+      assert(results.size() >= requests.size());
+
+      ReserveOrders((int)requests.size());
+      idIndex.ReserveIds(nextOrderId + (int)requests.size());
+
+      if (trackLevelChanges) {
+         AddReservedBatch<true>(requests, results, onFill);
+      } else {
+         AddReservedBatch<false>(requests, results, onFill);
+      }
+   }
 
-      if (isBuy) {
-         buyOrdersMap[price].map[id] = quantity;
-         buyOrdersMap[price].quantity += quantity;
+   bool CancelOrder(OrderId id) {
+      int slot = FindOrder(id);
+      if (slot < 0) {
+         return false;
+      }
+
+      const Order& order = orders[slot];
+      if (order.isBuy) {
+         RemoveOrder(buyLevels, slot);
       } else {
-         sellOrdersMap[price].map[id] = quantity;
-         sellOrdersMap[price].quantity += quantity;
+         RemoveOrder(sellLevels, slot);
+      }
+      FreeOrder(slot);
+      return true;
+   }
+
+   // Only reductions keep time priority, so increase is rejected, use cancel and add instead.
+   // Zero quantity cancels the order.
+   bool ModifyOrder(OrderId id, Quantity quantity) {
+      if (quantity <= 0) {
+         return CancelOrder(id);
+      }
+
+      int slot = FindOrder(id);
+      if (slot < 0) {
+         return false;
+      }
+
+      Order& order = orders[slot];
+      if (quantity > order.quantity) {
+         return false;
       }
-      return OrderResult{ id, MatchOrders() };
+
+      Level* level = order.isBuy ? buyLevels.Find(order.price) : sellLevels.Find(order.price);
+      level->quantity -= order.quantity - quantity;
+      MarkChanged(*level, order.isBuy, order.price);
+      order.quantity = quantity;
+      return true;
    }
 
    int TotalOrders() const {
-      return (int)orderToPriceMap.size();
+      return orderPool.Allocated();
+   }
+
+   std::optional<LevelInfo> BestBid() const {
+      return BestLevelInfo(buyLevels);
+   }
+
+   std::optional<LevelInfo> BestAsk() const {
+      return BestLevelInfo(sellLevels);
+   }
+
+   // Writes up to out.size() levels from the best one, returns written count
+   int GetDepth(bool isBuy, std::span<LevelInfo> out) const {
+      return isBuy ? GetDepth(buyLevels, out) : GetDepth(sellLevels, out);
+   }
+
+   // Off by default, when on ConsumeLevelChanges has to be polled, otherwise pending changes pile up
+   void TrackLevelChanges(bool enable) {
+      trackLevelChanges = enable;
+      if (!enable) {
+         changedLevels.clear();
+      }
+   }
+
+   // Levels changed since the previous call, each level reported once with its current quantity.
+   // Writes up to out.size() updates, the rest is returned by the next call.
+   int ConsumeLevelChanges(std::span<LevelUpdate> out) {
+      // a level can be erased and created again with the flag cleared, so it could be queued twice
+      std::sort(changedLevels.begin(), changedLevels.end());
+      changedLevels.erase(std::unique(changedLevels.begin(), changedLevels.end()), changedLevels.end());
+
+      int count = (int)std::min(out.size(), changedLevels.size());
+      for (int i = 0; i < count; ++i) {
+         auto [isBuy, price] = changedLevels[i];
+         Level* level = isBuy ? buyLevels.Find(price) : sellLevels.Find(price);
+         if (level) {
+            level->changed = false;
+         }
+         out[i] = LevelUpdate{ price, level ? level->quantity : 0, isBuy };
+      }
+
+      changedLevels.erase(changedLevels.begin(), changedLevels.begin() + count);
+      return count;
+   }
+
+   // Full state: levels of both sides with orders in FIFO order, id map and next order id.
+   // Level change feed state is not saved.
+   void SaveSnapshot(std::vector<uint8_t>& out) const {
+      // records are zeroed first, padding of wide types too, so equal books give equal bytes
+      SnapshotHeader header;
+      std::memset(static_cast<void*>(&header), 0, sizeof(header));
+      header.magic = SnapshotHeader::kMagic;
+      header.version = SnapshotHeader::kVersion;
+      header.nextOrderId = nextOrderId;
+      header.nOrders = TotalOrders();
+      header.nLevels[0] = CountLevels(buyLevels);
+      header.nLevels[1] = CountLevels(sellLevels);
+
+      size_t nLevels = header.nLevels[0] + header.nLevels[1];
+      out.resize(sizeof(SnapshotHeader) + nLevels * sizeof(SnapshotLevel) + header.nOrders * sizeof(SnapshotOrder));
+
+      uint8_t* levelsOut = out.data() + sizeof(SnapshotHeader);
+      uint8_t* ordersOut = levelsOut + nLevels * sizeof(SnapshotLevel);
+      std::memcpy(out.data(), &header, sizeof(header));
+
+      auto saveSide = [&](const auto& sideLevels) {
+         sideLevels.ForEachLevel([&](Price price, const Level& level) {
+            SnapshotLevel levelRecord;
+            std::memset(&levelRecord, 0, sizeof(levelRecord));
+            levelRecord.price = price;
+            for (int slot = level.queue.Front(); slot >= 0; slot = level.queue.Next(slot, HookOf())) {
+               SnapshotOrder orderRecord;
+               std::memset(&orderRecord, 0, sizeof(orderRecord));
+               orderRecord.id = orders[slot].id;
+               orderRecord.quantity = orders[slot].quantity;
+               std::memcpy(ordersOut, &orderRecord, sizeof(orderRecord));
+               ordersOut += sizeof(orderRecord);
+               ++levelRecord.nOrders;
+            }
+            std::memcpy(levelsOut, &levelRecord, sizeof(levelRecord));
+            levelsOut += sizeof(levelRecord);
+            return true;
+         });
+      };
+      saveSide(buyLevels);
+      saveSide(sellLevels);
+   }
+
+   // Replaces the book state. Orders are written to the slab in bulk and appended to their level, no matching.
+   // false if data is not a valid snapshot, the book is left unchanged then.
+   bool LoadSnapshot(std::span<const uint8_t> data) {
+      SnapshotHeader header;
+      if (!ValidateSnapshot(data, header)) {
+         return false;
+      }
+
+      sellLevels = {};
+      buyLevels = {};
+      orders.clear();
+      changedLevels.clear();
+      // filled by validation
+      std::swap(idIndex, loadIdIndex);
+      loadIdIndex.Clear();
+
+      if (header.nOrders > orderPool.Capacity()) {
+         orderPool.Grow(header.nOrders);
+      }
+      orders.resize(header.nOrders);
+      orderPool.Reset(header.nOrders);
+      nextOrderId = header.nextOrderId;
+
+      const uint8_t* levelsIn = data.data() + sizeof(SnapshotHeader);
+      const uint8_t* ordersIn = levelsIn + ((size_t)header.nLevels[0] + header.nLevels[1]) * sizeof(SnapshotLevel);
+
+      int slot = 0;
+      auto loadSide = [&](auto& sideLevels, int nSideLevels, bool isBuy) {
+         for (int i = 0; i < nSideLevels; ++i) {
+            SnapshotLevel levelRecord;
+            std::memcpy(&levelRecord, levelsIn, sizeof(levelRecord));
+            levelsIn += sizeof(levelRecord);
+
+            Level& level = sideLevels[levelRecord.price];
+            for (int end = slot + levelRecord.nOrders; slot < end; ++slot) {
+               SnapshotOrder orderRecord;
+               std::memcpy(&orderRecord, ordersIn + slot * sizeof(SnapshotOrder), sizeof(orderRecord));
+
+               orders[slot] = Order{ orderRecord.id, levelRecord.price, orderRecord.quantity, {}, isBuy };
+               level.queue.PushBack(slot, orderRecord.id, HookOf());
+               level.quantity += orderRecord.quantity;
+            }
+         }
+      };
+      loadSide(buyLevels, header.nLevels[0], true);
+      loadSide(sellLevels, header.nLevels[1], false);
+      return true;
    }
 
 private:
-   struct OrdersMapLevelInfo {
-      std::map<OrderId, Quantity> map;
+   struct SnapshotHeader {
+      static constexpr uint64_t kMagic = 0x50414e53534b4f42; // "BOKSSNAP"
+      static constexpr uint32_t kVersion = 1;
+
+      uint64_t magic = kMagic;
+      uint32_t version = kVersion;
+      int32_t nOrders;
+      OrderId nextOrderId;
+      int32_t nLevels[2]; // buy, sell
+      int32_t reserved = 0;
+   };
+
+   struct SnapshotLevel {
+      Price price;
+      int32_t nOrders;
+   };
+
+   struct SnapshotOrder {
+      OrderId id;
       Quantity quantity;
    };
 
-   std::map<Price, OrdersMapLevelInfo> sellOrdersMap;
-   std::map<Price, OrdersMapLevelInfo, std::greater<>> buyOrdersMap;
-   std::map<OrderId, std::pair<Price, bool>> orderToPriceMap;
+   // Everything LoadSnapshot relies on: sizes add up, levels of a side are unique and ordered best to worst
+   // as SaveSnapshot writes them, the book is not crossed, quantities are positive, ids are issued and unique,
+   // the id index can hold the next id. Id index of the snapshot is built in loadIdIndex on the way, it grows
+   // with the ids actually present, so a corrupt header can't make it allocate.
+   bool ValidateSnapshot(std::span<const uint8_t> data, SnapshotHeader& header) {
+      if (data.size() < sizeof(header)) {
+         return false;
+      }
+      std::memcpy(&header, data.data(), sizeof(header));
 
-   TradeResult MatchOrders() {
-      TradeResult result{};
+      if (header.magic != SnapshotHeader::kMagic || header.version != SnapshotHeader::kVersion
+         || header.nOrders < 0 || header.nextOrderId < header.nOrders || !IdIndex::CanHold(header.nextOrderId)
+         || header.nLevels[0] < 0 || header.nLevels[1] < 0) {
+         return false;
+      }
+      size_t nLevels = (size_t)header.nLevels[0] + header.nLevels[1];
+      if (data.size() != sizeof(SnapshotHeader) + nLevels * sizeof(SnapshotLevel) + header.nOrders * sizeof(SnapshotOrder)) {
+         return false;
+      }
 
-      auto sellLowerIt = sellOrdersMap.begin();
-      auto buyHighestIt = buyOrdersMap.begin();
+      const uint8_t* levelsIn = data.data() + sizeof(SnapshotHeader);
+      const uint8_t* ordersIn = levelsIn + nLevels * sizeof(SnapshotLevel);
 
-      while (sellLowerIt != sellOrdersMap.end() && buyHighestIt != buyOrdersMap.end()) {
-         if (buyHighestIt->first < sellLowerIt->first) {
-            break;
+      loadIdIndex.Clear();
+      int slot = 0;
+      std::optional<Price> best[2];
+      for (int side = 0; side < 2; ++side) {
+         bool isBuy = side == 0;
+         std::optional<Price> prevPrice;
+         for (int i = 0; i < header.nLevels[side]; ++i) {
+            SnapshotLevel levelRecord;
+            std::memcpy(&levelRecord, levelsIn, sizeof(levelRecord));
+            levelsIn += sizeof(levelRecord);
+
+            if (levelRecord.nOrders <= 0 || levelRecord.nOrders > header.nOrders - slot) {
+               return false;
+            }
+            if (prevPrice && (isBuy ? levelRecord.price >= *prevPrice : levelRecord.price <= *prevPrice)) {
+               return false;
+            }
+            if (!prevPrice) {
+               best[side] = levelRecord.price;
+            }
+            prevPrice = levelRecord.price;
+
+            for (int end = slot + levelRecord.nOrders; slot < end; ++slot) {
+               SnapshotOrder orderRecord;
+               std::memcpy(&orderRecord, ordersIn + slot * sizeof(SnapshotOrder), sizeof(orderRecord));
+               if (orderRecord.id < 0 || orderRecord.id >= header.nextOrderId || orderRecord.quantity <= 0
+                  || loadIdIndex.Find(orderRecord.id) >= 0) {
+                  return false;
+               }
+               loadIdIndex.Insert(orderRecord.id, slot);
+            }
          }
+      }
 
-         auto& sellOrders = sellLowerIt->second.map;
-         auto& buyOrders = buyHighestIt->second.map;
+      return slot == header.nOrders && !(best[0] && best[1] && *best[0] >= *best[1]);
+   }
 
-         Quantity& sellQuantities = sellLowerIt->second.quantity;
-         Quantity& buyQuantities = buyHighestIt->second.quantity;
+   template<typename SideLevels>
+   static int CountLevels(const SideLevels& sideLevels) {
+      int count = 0;
+      sideLevels.ForEachLevel([&](Price, const Level&) {
+         ++count;
+         return true;
+      });
+      return count;
+   }
 
-         auto sellOrderIt = sellOrders.begin();
-         auto buyOrderIt = buyOrders.begin();
+   using LevelQueue = typename Policy::template LevelQueue<OrderId>;
+   using QueueHook = typename LevelQueue::Hook;
 
-         while (sellOrderIt != sellOrders.end() && buyOrderIt != buyOrders.end()) {
-            Quantity quantity = std::min(sellOrderIt->second, buyOrderIt->second);
+   struct Order {
+      OrderId id;
+      Price price;
+      Quantity quantity;
+      QueueHook hook;
+      bool isBuy;
+   };
 
-            result.volume += quantity;
+   // Orders of a price level in time priority
+   struct Level {
+      LevelQueue queue;
+      Quantity quantity = 0;
+      bool changed = false; // already queued in changedLevels
 
-            sellOrderIt->second -= quantity;
-            buyOrderIt->second -= quantity;
+      bool Empty() const { return queue.Empty(); }
+   };
 
-            sellQuantities -= quantity;
-            buyQuantities -= quantity;
+   typename Policy::template Levels<Price, Level, std::less<>> sellLevels;
+   typename Policy::template Levels<Price, Level, std::greater<>> buyLevels;
 
-            if (sellOrderIt->second == 0) {
-               orderToPriceMap.erase(sellOrderIt->first);
-               sellOrderIt = sellOrders.erase(sellOrderIt);
-               ++result.canceledOrders;
+   bool trackLevelChanges = false;
+   std::vector<std::pair<bool, Price>> changedLevels; // isBuy, price
+
+   // kTrack false is used by adds which already checked trackLevelChanges
+   template<bool kTrack = true>
+   void MarkChanged(Level& level, bool isBuy, Price price) {
+      if (kTrack && trackLevelChanges && !level.changed) {
+         level.changed = true;
+         changedLevels.emplace_back(isBuy, price);
+      }
+   }
+
+   template<typename SideLevels>
+   static std::optional<LevelInfo> BestLevelInfo(const SideLevels& sideLevels) {
+      if (sideLevels.Empty()) {
+         return {};
+      }
+      return LevelInfo{ sideLevels.BestPrice(), sideLevels.BestLevel().quantity };
+   }
+
+   template<typename SideLevels>
+   static int GetDepth(const SideLevels& sideLevels, std::span<LevelInfo> out) {
+      int count = 0;
+      sideLevels.ForEachLevel([&](Price price, const Level& level) {
+         if (count == (int)out.size()) {
+            return false;
+         }
+         out[count++] = LevelInfo{ price, level.quantity };
+         return true;
+      });
+      return count;
+   }
+
+   // Dense order slab, slots recycled through the pool
+   std::vector<Order> orders;
+   IndexPool orderPool;
+   using IdIndex = typename Policy::template IdIndex<OrderId>;
+   IdIndex idIndex; // resting orders only
+   IdIndex loadIdIndex; // scratch of LoadSnapshot, swapped in on success
+
+   // Slab and pool fit n more resting orders, grow at least twice
+   void ReserveOrders(int n) {
+      if (orderPool.Available() < n) {
+         int capacity = std::max(2 * orderPool.Capacity(), orderPool.Allocated() + n);
+         orderPool.Grow(capacity);
+         orders.reserve(capacity);
+      }
+   }
+
+   // Caller reserves the slot with ReserveOrders
+   int AllocateOrder(OrderId id, Price price, Quantity quantity, bool isBuy) {
+      int slot = orderPool.Allocate();
+      if (slot == (int)orders.size()) {
+         orders.emplace_back();
+      }
+      orders[slot] = Order{ id, price, quantity, {}, isBuy };
+      idIndex.Insert(id, slot);
+      return slot;
+   }
+
+   void FreeOrder(int slot) {
+      idIndex.Erase(orders[slot].id);
+      orderPool.Free(slot);
+   }
+
+   int FindOrder(OrderId id) const {
+      return idIndex.Find(id);
+   }
+
+   auto HookOf() {
+      return [this](int slot) -> QueueHook& { return orders[slot].hook; };
+   }
+
+   auto HookOf() const {
+      return [this](int slot) -> const QueueHook& { return orders[slot].hook; };
+   }
+
+   void PushBack(Level& level, int slot) {
+      const Order& order = orders[slot];
+      level.queue.PushBack(slot, order.id, HookOf());
+      level.quantity += order.quantity;
+   }
+
+   void Unlink(Level& level, int slot) {
+      level.queue.Unlink(slot, HookOf());
+      level.quantity -= orders[slot].quantity;
+   }
+
+   template<typename SideLevels>
+   void RemoveOrder(SideLevels& sideLevels, int slot) {
+      const Order& order = orders[slot];
+      Level* level = sideLevels.Find(order.price);
+
+      Unlink(*level, slot);
+      MarkChanged(*level, order.isBuy, order.price);
+      if (level->Empty()) {
+         sideLevels.Erase(order.price);
+      }
+   }
+
+   // AddOrder body, one order slot has to be reserved
+   template<bool kTrack, typename FillSink>
+   OrderResult AddReserved(const OrderRequest& request, FillSink& onFill) {
+      OrderId id = GetNextOrderId();
+
+      Price limit = request.price;
+      if (request.type == OrderType::Market) {
+         limit = request.isBuy ? std::numeric_limits<Price>::max() : std::numeric_limits<Price>::lowest();
+      }
+
+      if (request.type == OrderType::FillOrKill) {
+         bool canFill = request.isBuy ? CanFill(sellLevels, true, limit, request.quantity)
+            : CanFill(buyLevels, false, limit, request.quantity);
+         if (!canFill) {
+            return OrderResult{ id, TradeResult{} };
+         }
+      }
+
+      TradeResult result{};
+      Quantity remaining = request.isBuy ? MatchIncoming<kTrack>(sellLevels, true, id, limit, request.quantity, onFill, result)
+         : MatchIncoming<kTrack>(buyLevels, false, id, limit, request.quantity, onFill, result);
+
+      if (remaining == 0) {
+         ++result.canceledOrders;
+      } else if (request.type == OrderType::Limit) {
+         int slot = AllocateOrder(id, request.price, remaining, request.isBuy);
+         if (request.isBuy) {
+            Level& level = buyLevels[request.price];
+            PushBack(level, slot);
+            MarkChanged<kTrack>(level, true, request.price);
+         } else {
+            Level& level = sellLevels[request.price];
+            PushBack(level, slot);
+            MarkChanged<kTrack>(level, false, request.price);
+         }
+      }
+      return OrderResult{ id, result };
+   }
+
+   // AddOrders body, slots for all requests have to be reserved
+   template<bool kTrack, typename FillSink>
+   void AddReservedBatch(std::span<const OrderRequest> requests, std::span<OrderResult> results, FillSink& onFill) {
+      // Cached best prices may only be more aggressive than the real ones, then an order which could rest
+      // takes the matching path and the result is still the same. Resting orders only improve own side.
+      Price bestBid = BestPriceOr(buyLevels, std::numeric_limits<Price>::lowest());
+      Price bestAsk = BestPriceOr(sellLevels, std::numeric_limits<Price>::max());
+
+      // level of the previous resting order, valid while only orders resting on it follow
+      Level* runLevel = nullptr;
+      Price runPrice = 0;
+      bool runIsBuy = false;
+
+      for (size_t i = 0; i < requests.size(); ++i) {
+         const OrderRequest& request = requests[i];
+         bool rests = request.type == OrderType::Limit && request.quantity > 0
+            && (request.isBuy ? request.price < bestAsk : request.price > bestBid);
+
+         if (!rests) {
+            results[i] = AddReserved<kTrack>(request, onFill);
+            // only the maker side is re-read, remainder of the taker could rest at its price
+            if (request.isBuy) {
+               bestAsk = BestPriceOr(sellLevels, std::numeric_limits<Price>::max());
+               bestBid = request.type == OrderType::Limit ? std::max(bestBid, request.price) : bestBid;
+            } else {
+               bestBid = BestPriceOr(buyLevels, std::numeric_limits<Price>::lowest());
+               bestAsk = request.type == OrderType::Limit ? std::min(bestAsk, request.price) : bestAsk;
             }
-            if (buyOrderIt->second == 0) {
-               orderToPriceMap.erase(buyOrderIt->first);
-               buyOrderIt = buyOrders.erase(buyOrderIt);
-               ++result.canceledOrders;
+            runLevel = nullptr;
+            continue;
+         }
+
+         OrderId id = GetNextOrderId();
+         int slot = AllocateOrder(id, request.price, request.quantity, request.isBuy);
+
+         if (!runLevel || runPrice != request.price || runIsBuy != request.isBuy) {
+            runLevel = request.isBuy ? &buyLevels[request.price] : &sellLevels[request.price];
+            runPrice = request.price;
+            runIsBuy = request.isBuy;
+            MarkChanged<kTrack>(*runLevel, request.isBuy, request.price);
+
+            if (request.isBuy) {
+               bestBid = std::max(bestBid, request.price);
+            } else {
+               bestAsk = std::min(bestAsk, request.price);
             }
          }
+         PushBack(*runLevel, slot);
+
+         results[i] = OrderResult{ id, TradeResult{} };
+      }
+   }
+
+   template<typename SideLevels>
+   static Price BestPriceOr(const SideLevels& sideLevels, Price empty) {
+      return sideLevels.Empty() ? empty : sideLevels.BestPrice();
+   }
+
+   // Matches taker against maker side levels up to limit price, returns unfilled quantity
+   template<bool kTrack, typename SideLevels, typename FillSink>
+   Quantity MatchIncoming(SideLevels& makerLevels, bool takerIsBuy, OrderId takerId, Price limit, Quantity quantity,
+      FillSink& onFill, TradeResult& result) {
+      while (quantity > 0 && !makerLevels.Empty()) {
+         Price price = makerLevels.BestPrice();
+         if (takerIsBuy ? price > limit : price < limit) {
+            break;
+         }
 
-         if (sellOrderIt == sellOrders.end()) {
-            sellLowerIt = sellOrdersMap.erase(sellLowerIt);
+         Level& level = makerLevels.BestLevel();
+         MarkChanged<kTrack>(level, !takerIsBuy, price);
+
+         while (quantity > 0 && !level.Empty()) {
+            int makerSlot = level.queue.Front();
+            Order& maker = orders[makerSlot];
+            Quantity fillQuantity = std::min(quantity, maker.quantity);
+
+            result.volume += fillQuantity;
+            onFill(Fill{ maker.id, takerId, price, fillQuantity });
+
+            maker.quantity -= fillQuantity;
+            level.quantity -= fillQuantity;
+            quantity -= fillQuantity;
+
+            if (maker.quantity == 0) {
+               Unlink(level, makerSlot);
+               FreeOrder(makerSlot);
+               ++result.canceledOrders;
+            }
          }
-         if (buyOrderIt == buyOrders.end()) {
-            buyHighestIt = buyOrdersMap.erase(buyHighestIt);
+
+         if (level.Empty()) {
+            makerLevels.EraseBest();
          }
       }
 
-      return result;
+      return quantity;
+   }
+
+   // Liquidity check on aggregated level quantities, no order is touched
+   template<typename SideLevels>
+   static bool CanFill(const SideLevels& makerLevels, bool takerIsBuy, Price limit, Quantity quantity) {
+      Quantity available = 0;
+      makerLevels.ForEachLevel([&](Price price, const Level& level) {
+         if (takerIsBuy ? price > limit : price < limit) {
+            return false;
+         }
+         available += level.quantity;
+         return available < quantity;
+      });
+      return available >= quantity;
    }
 
    OrderId nextOrderId = 0;
@@ -122,3 +697,9 @@ private:
       return nextOrderId++;
    }
 };
+
+using OrderBook = BasicOrderBook<DefaultOrderBookPolicy>;
+using LadderOrderBook = BasicOrderBook<LadderOrderBookPolicy>;
+using MapQueueOrderBook = BasicOrderBook<MapQueueOrderBookPolicy>;
+using HashIndexOrderBook = BasicOrderBook<HashIndexOrderBookPolicy>;
+using WideOrderBook = BasicOrderBook<WideOrderBookPolicy>;
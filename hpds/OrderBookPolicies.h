@@ -0,0 +1,330 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "PriceLadder.h"
+
+// Building blocks for BasicOrderBook policies.
+// Level containers: Levels<Price, Level, Compare>, one book side, Compare tells which price is better.
+// Level queues: LevelQueue<OrderId>, time priority of order slots inside a level. Hook is stored in every order.
+// Id indexes: IdIndex<OrderId>, order id -> slot of a resting order. CanHold(id) tells if id can be indexed at all.
+
+// Price levels of one book side in a tree, any price range
+template<typename Price, typename Level, typename Compare>
+class MapLevels {
+public:
+   Level& operator[](Price price) {
+      return levels[price];
+   }
+
+   bool Empty() const {
+      return levels.empty();
+   }
+
+   Price BestPrice() const {
+      return levels.begin()->first;
+   }
+
+   Level& BestLevel() {
+      return levels.begin()->second;
+   }
+
+   const Level& BestLevel() const {
+      return levels.begin()->second;
+   }
+
+   // Levels from best to worst, stops when fn(price, level) returns false
+   template<typename F>
+   void ForEachLevel(F&& fn) const {
+      for (const auto& [price, level] : levels) {
+         if (!fn(price, level)) {
+            return;
+         }
+      }
+   }
+
+   void EraseBest() {
+      levels.erase(levels.begin());
+   }
+
+   Level* Find(Price price) {
+      auto it = levels.find(price);
+      return it != levels.end() ? &it->second : nullptr;
+   }
+
+   void Erase(Price price) {
+      levels.erase(price);
+   }
+
+private:
+   std::map<Price, Level, Compare> levels;
+};
+
+// Intrusive doubly linked list over order slots, O(1) append, pop front and unlink from the middle
+template<typename OrderId>
+class IntrusiveListQueue {
+public:
+   struct Hook {
+      int prev = -1;
+      int next = -1;
+   };
+
+   bool Empty() const {
+      return head < 0;
+   }
+
+   int Front() const {
+      return head;
+   }
+
+   // hookOf(slot) -> Hook&
+   template<typename HookOf>
+   int Next(int slot, HookOf&& hookOf) const {
+      return hookOf(slot).next;
+   }
+
+   template<typename HookOf>
+   void PushBack(int slot, OrderId, HookOf&& hookOf) {
+      Hook& hook = hookOf(slot);
+      hook.prev = tail;
+      hook.next = -1;
+
+      if (tail >= 0) {
+         hookOf(tail).next = slot;
+      } else {
+         head = slot;
+      }
+      tail = slot;
+   }
+
+   template<typename HookOf>
+   void Unlink(int slot, HookOf&& hookOf) {
+      const Hook& hook = hookOf(slot);
+
+      if (hook.prev >= 0) {
+         hookOf(hook.prev).next = hook.next;
+      } else {
+         head = hook.next;
+      }
+      if (hook.next >= 0) {
+         hookOf(hook.next).prev = hook.prev;
+      } else {
+         tail = hook.prev;
+      }
+   }
+
+private:
+   int head = -1;
+   int tail = -1;
+};
+
+// Tree keyed by order id (ids grow with time), node allocation per order. Kept to compare with intrusive list.
+template<typename OrderId>
+class MapQueue {
+public:
+   using Map = std::map<OrderId, int>; // order id -> slot
+
+   struct Hook {
+      typename Map::iterator it;
+   };
+
+   bool Empty() const {
+      return orders.empty();
+   }
+
+   int Front() const {
+      return orders.begin()->second;
+   }
+
+   template<typename HookOf>
+   int Next(int slot, HookOf&& hookOf) const {
+      auto it = std::next(hookOf(slot).it);
+      return it != orders.end() ? it->second : -1;
+   }
+
+   template<typename HookOf>
+   void PushBack(int slot, OrderId id, HookOf&& hookOf) {
+      hookOf(slot).it = orders.emplace_hint(orders.end(), id, slot);
+   }
+
+   template<typename HookOf>
+   void Unlink(int slot, HookOf&& hookOf) {
+      orders.erase(hookOf(slot).it);
+   }
+
+private:
+   Map orders;
+};
+
+// Order ids are issued sequentially, so id -> slot is an array, split in pages of kPageSize ids.
+// A page is released when its last resting order leaves, so memory is bound by pages with resting orders
+// plus a page table of 8 bytes per kPageSize issued ids. Released pages are reused, no allocations in a steady state.
+template<typename OrderId>
+class DenseIdIndex {
+public:
+   static constexpr int kPageBits = 12;
+   static constexpr size_t kPageSize = size_t(1) << kPageBits;
+   // Page table grows with the largest id, from 2^40 ids on it would take gigabytes
+   static constexpr size_t kMaxIds = size_t(1) << 40;
+
+   static bool CanHold(OrderId id) {
+      return id >= 0 && size_t(id) < kMaxIds;
+   }
+
+   int Find(OrderId id) const {
+      const Page* page = PageOf(id);
+      return page ? page->slots[size_t(id) & (kPageSize - 1)] : -1;
+   }
+
+   void Insert(OrderId id, int slot) {
+      size_t pageIndex = size_t(id) >> kPageBits;
+      if (pageIndex >= pages.size()) {
+         pages.resize(pageIndex + 1);
+      }
+
+      auto& page = pages[pageIndex];
+      if (!page) {
+         if (freePages.empty()) {
+            page = std::make_unique<Page>();
+         } else {
+            page = std::move(freePages.back());
+            freePages.pop_back();
+         }
+         ++pagesInUse;
+      }
+
+      int& entry = page->slots[size_t(id) & (kPageSize - 1)];
+      page->live += entry < 0;
+      entry = slot;
+   }
+
+   void Erase(OrderId id) {
+      auto& page = pages[size_t(id) >> kPageBits];
+      page->slots[size_t(id) & (kPageSize - 1)] = -1;
+      if (--page->live == 0) {
+         // all entries are -1 again, ready for reuse
+         freePages.push_back(std::move(page));
+         --pagesInUse;
+      }
+   }
+
+   void Clear() {
+      for (auto& page : pages) {
+         if (page) {
+            std::fill(std::begin(page->slots), std::end(page->slots), -1);
+            page->live = 0;
+            freePages.push_back(std::move(page));
+         }
+      }
+      pages.clear();
+      pagesInUse = 0;
+   }
+
+   // Room in the page table for ids below endId
+   void ReserveIds(OrderId endId) {
+      size_t wanted = (size_t(endId) >> kPageBits) + 1;
+      if (wanted > pages.capacity()) {
+         pages.reserve(std::max(wanted, pages.capacity() * 2));
+      }
+   }
+
+   // Pages holding resting orders
+   size_t PagesInUse() const {
+      return pagesInUse;
+   }
+
+private:
+   struct Page {
+      Page() { std::fill(std::begin(slots), std::end(slots), -1); }
+
+      int slots[kPageSize];
+      int live = 0;
+   };
+
+   std::vector<std::unique_ptr<Page>> pages; // null when no order of the page rests
+   std::vector<std::unique_ptr<Page>> freePages;
+   size_t pagesInUse = 0;
+
+   const Page* PageOf(OrderId id) const {
+      size_t pageIndex = size_t(id) >> kPageBits;
+      return id >= 0 && pageIndex < pages.size() ? pages[pageIndex].get() : nullptr;
+   }
+};
+
+// Memory bound by resting orders instead of issued ids, for any id scheme
+template<typename OrderId>
+class HashIdIndex {
+public:
+   int Find(OrderId id) const {
+      auto it = slots.find(id);
+      return it != slots.end() ? it->second : -1;
+   }
+
+   void Insert(OrderId id, int slot) {
+      slots[id] = slot;
+   }
+
+   void Erase(OrderId id) {
+      slots.erase(id);
+   }
+
+   void Clear() {
+      slots.clear();
+   }
+
+   // Size depends on resting orders, not on ids
+   void ReserveIds(OrderId) {}
+
+   static bool CanHold(OrderId) {
+      return true;
+   }
+
+private:
+   std::unordered_map<OrderId, int> slots;
+};
+
+// Policies, derive and override to build a new combination
+
+struct DefaultOrderBookPolicy {
+   using OrderId = int;
+   using Price = int;
+   using Quantity = int;
+
+   template<typename P, typename L, typename C>
+   using Levels = MapLevels<P, L, C>;
+
+   template<typename Id>
+   using LevelQueue = IntrusiveListQueue<Id>;
+
+   template<typename Id>
+   using IdIndex = DenseIdIndex<Id>;
+};
+
+// Array-backed levels, best bid/ask tracked directly. For prices in a narrow tick band.
+struct LadderOrderBookPolicy : DefaultOrderBookPolicy {
+   template<typename P, typename L, typename C>
+   using Levels = PriceLadder<P, L, C>;
+};
+
+// Per level std::map of orders
+struct MapQueueOrderBookPolicy : DefaultOrderBookPolicy {
+   template<typename Id>
+   using LevelQueue = MapQueue<Id>;
+};
+
+struct HashIndexOrderBookPolicy : DefaultOrderBookPolicy {
+   template<typename Id>
+   using IdIndex = HashIdIndex<Id>;
+};
+
+// 64 bit ids and prices on ladder levels. Ladder offsets are 64 bit and its window is capped,
+// prices far from the occupied band go to its tree, so the whole int64 range is usable.
+struct WideOrderBookPolicy : LadderOrderBookPolicy {
+   using OrderId = int64_t;
+   using Price = int64_t;
+};
@@ -0,0 +1,232 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "OccupancyBitmap.h"
+
+// Price levels of one book side stored in a contiguous array indexed by tick offset from a movable base.
+// Compare defines which price is better: std::less<> for asks, std::greater<> for bids.
+// Meant for instruments which trade in a narrow tick band, memory is proportional to the occupied price span.
+// Occupied levels are tracked in a bitmap, so the next best level after a drained one is found without a scan.
+// The window is capped at maxSize ticks, outlier prices that don't fit with the occupied levels go to a tree.
+template<typename Price, typename Level, typename Compare>
+class PriceLadder {
+public:
+   PriceLadder(int initialSize = 256, int maxSize = 1 << 16) : maxSize(std::max(initialSize, maxSize)) {
+      levels.resize(initialSize);
+      occupied.Resize(initialSize);
+   }
+
+   Level& operator[](Price price) {
+      if (!InWindow(price) && !Recenter(price)) {
+         return farLevels[price];
+      }
+
+      int index = int(Offset(price));
+      Occupy(index);
+      return levels[index];
+   }
+
+   Level* Find(Price price) {
+      if (!InWindow(price)) {
+         auto it = farLevels.find(price);
+         return it != farLevels.end() ? &it->second : nullptr;
+      }
+      int index = int(Offset(price));
+      return levels[index].Empty() ? nullptr : &levels[index];
+   }
+
+   // Level at price must be drained
+   void Erase(Price price) {
+      if (!InWindow(price)) {
+         farLevels.erase(price);
+         return;
+      }
+
+      int index = int(Offset(price));
+      if (index == bestIndex) {
+         EraseBestInWindow();
+         return;
+      }
+
+      levels[index] = Level{};
+      occupied.Clear(index);
+      if (index == worstIndex) {
+         // best level is occupied, so there is one
+         worstIndex = kAscending ? occupied.PrevSet(index) : occupied.NextSet(index);
+      }
+   }
+
+   bool Empty() const {
+      return WindowEmpty() && farLevels.empty();
+   }
+
+   Price BestPrice() const {
+      return FarIsBest() ? farLevels.begin()->first : Price(base + bestIndex);
+   }
+
+   Level& BestLevel() {
+      return FarIsBest() ? farLevels.begin()->second : levels[bestIndex];
+   }
+
+   const Level& BestLevel() const {
+      return FarIsBest() ? farLevels.begin()->second : levels[bestIndex];
+   }
+
+   // Occupied levels from best to worst, stops when fn(price, level) returns false
+   template<typename F>
+   void ForEachLevel(F&& fn) const {
+      auto far = farLevels.begin();
+      int i = bestIndex;
+      while (i >= 0 || far != farLevels.end()) {
+         if (i < 0 || (far != farLevels.end() && Compare{}(far->first, Price(base + i)))) {
+            if (!fn(far->first, far->second)) {
+               return;
+            }
+            ++far;
+         } else {
+            if (!fn(Price(base + i), levels[i])) {
+               return;
+            }
+            i = NextOccupied(i);
+         }
+      }
+   }
+
+   void EraseBest() {
+      if (FarIsBest()) {
+         farLevels.erase(farLevels.begin());
+         return;
+      }
+      EraseBestInWindow();
+   }
+
+private:
+   static constexpr bool kAscending = Compare{}(0, 1);
+   static constexpr int kStep = kAscending ? 1 : -1;
+
+   std::vector<Level> levels;
+   OccupancyBitmap occupied; // non-empty levels
+   Price base = 0;
+   int bestIndex = -1;
+   int worstIndex = -1;
+   int maxSize;
+
+   // Levels outside the window, never overlaps it
+   std::map<Price, Level, Compare> farLevels;
+
+   // Unsigned 64 bit, distance between any two int64 prices fits and wraps instead of overflowing.
+   // A price below base wraps to a huge offset, so one comparison tells if it is in the window.
+   uint64_t Offset(Price price) const {
+      return uint64_t(int64_t(price)) - uint64_t(int64_t(base));
+   }
+
+   bool InWindow(Price price) const {
+      return Offset(price) < levels.size();
+   }
+
+   bool WindowEmpty() const {
+      return bestIndex < 0;
+   }
+
+   bool FarIsBest() const {
+      return !farLevels.empty() && (WindowEmpty() || Compare{}(farLevels.begin()->first, Price(base + bestIndex)));
+   }
+
+   bool IsBetter(int lhs, int rhs) const {
+      return kAscending ? lhs < rhs : lhs > rhs;
+   }
+
+   void Occupy(int index) {
+      occupied.Set(index);
+      if (WindowEmpty()) {
+         bestIndex = worstIndex = index;
+      } else if (IsBetter(index, bestIndex)) {
+         bestIndex = index;
+      } else if (IsBetter(worstIndex, index)) {
+         worstIndex = index;
+      }
+   }
+
+   void EraseBestInWindow() {
+      levels[bestIndex] = Level{};
+      occupied.Clear(bestIndex);
+      if (bestIndex == worstIndex) {
+         bestIndex = worstIndex = -1;
+         return;
+      }
+      bestIndex = NextOccupied(bestIndex);
+   }
+
+   // Next worse occupied level, -1 after the worst one
+   int NextOccupied(int index) const {
+      return kAscending ? occupied.NextSet(index + 1) : occupied.PrevSet(index - 1);
+   }
+
+   // Moves the window so it covers price and all occupied levels, grows it when the span does not fit.
+   // Rare when prices stay in the band, so the copy is amortized over many inserts.
+   // false if the span exceeds maxSize, the window is left as is and price goes to the far levels.
+   bool Recenter(Price price) {
+      int64_t size = (int64_t)levels.size();
+      int64_t lo = price;
+      int64_t hi = price;
+      if (!WindowEmpty()) {
+         lo = std::min(lo, int64_t(base) + std::min(bestIndex, worstIndex));
+         hi = std::max(hi, int64_t(base) + std::max(bestIndex, worstIndex));
+      }
+
+      // unsigned, hi - lo of the full int64 range does not fit in int64
+      uint64_t distance = uint64_t(hi) - uint64_t(lo);
+      if (distance >= (uint64_t)maxSize) {
+         return false;
+      }
+      int64_t span = int64_t(distance) + 1;
+
+      int64_t newSize = size;
+      while (newSize < span * 2) {
+         newSize *= 2;
+      }
+      newSize = std::min(newSize, (int64_t)maxSize);
+
+      // window [newBase, newBase + newSize - 1] is kept inside the Price range, saturates at both ends
+      constexpr int64_t kLowest = std::numeric_limits<Price>::lowest();
+      constexpr int64_t kMax = std::numeric_limits<Price>::max();
+      int64_t pad = (newSize - span) / 2;
+      int64_t newBase = uint64_t(lo) - uint64_t(kLowest) >= uint64_t(pad) ? lo - pad : kLowest;
+      newBase = std::min(newBase, kMax - (newSize - 1));
+
+      if (WindowEmpty() && newSize == size) {
+         base = Price(newBase);
+      } else {
+         std::vector<Level> newLevels(newSize);
+         OccupancyBitmap newOccupied((int)newSize);
+         int shift = int(int64_t(uint64_t(int64_t(base)) - uint64_t(newBase))); // used only for occupied levels
+         for (int i = occupied.NextSet(0); i >= 0; i = occupied.NextSet(i + 1)) {
+            newLevels[i + shift] = std::move(levels[i]);
+            newOccupied.Set(i + shift);
+         }
+
+         levels.swap(newLevels);
+         occupied = std::move(newOccupied);
+         base = Price(newBase);
+         if (!WindowEmpty()) {
+            bestIndex += shift;
+            worstIndex += shift;
+         }
+      }
+
+      // far levels the window now covers move in
+      Price first = Price(kAscending ? newBase : newBase + (newSize - 1));
+      Price last = Price(kAscending ? newBase + (newSize - 1) : newBase);
+      for (auto it = farLevels.lower_bound(first); it != farLevels.end() && !Compare{}(last, it->first);) {
+         int index = int(Offset(it->first));
+         levels[index] = std::move(it->second);
+         Occupy(index);
+         it = farLevels.erase(it);
+      }
+      return true;
+   }
+};
@@ -1,52 +1,139 @@
 #pragma once
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
 #include <optional>
+#include <span>
+#include <thread>
+#include <vector>
 
-#define ALIGN_CACHE_LINE alignas(std::hardware_destructive_interference_size)
+#include "CacheLine.h"
+#include "WaitStrategy.h"
 
-template<typename T>
+// Single producer single consumer queue. Keeps one slot empty, so holds up to capacity - 1 elements.
+// With PowerOfTwoCapacity indices wrap by masking instead of a compare, capacity must be a power of two.
+// WaitStrategy decides how PopWait idles, see WaitStrategy.h
+template<typename T, bool PowerOfTwoCapacity = false, typename WaitStrategy = BusySpinWait>
 class RingBuffer {
 public:
    RingBuffer(int capacity) : capacity(capacity) {
+      assert(!PowerOfTwoCapacity || std::has_single_bit((unsigned)capacity));
       buffer.resize(capacity);
    }
 
    bool Push(const T& data) {
+      T* slot = TryClaim();
+      if (!slot) {
+         return false;
+      }
+
+      *slot = data;
+      Commit();
+      return true;
+   }
+
+   std::optional<T> Pop() {
+      T* slot = Peek();
+      if (!slot) {
+         return {};
+      }
+
+      std::optional<T> data = std::move(*slot);
+      Release();
+      return data;
+   }
+
+   // Producer side zero copy: slot to construct the next element in, nullptr if full.
+   // Nothing is visible to the consumer until Commit
+   T* TryClaim() {
       int curTail = tail.load(std::memory_order::relaxed);
       int nextTail = Increment(curTail);
 
       if (nextTail == headCached) {
          headCached = head.load(std::memory_order::acquire);
          if (nextTail == headCached) {
-            return false;
+            return nullptr;
          }
       }
 
-      buffer[curTail] = data;
-      tail.store(nextTail, std::memory_order::release);
-
-      return true;
+      return &buffer[curTail];
+   }
 
+   // Publishes the slot returned by the last successful TryClaim
+   void Commit() {
+      int curTail = tail.load(std::memory_order::relaxed);
+      tail.store(Increment(curTail), std::memory_order::release);
+      waitStrategy.Notify(tail);
    }
 
-   std::optional<T> Pop() {
+   // Consumer side zero copy: oldest element, nullptr if empty. Stays valid until Release
+   T* Peek() {
       int curHead = head.load(std::memory_order::relaxed);
       if (curHead == tailCached) {
          tailCached = tail.load(std::memory_order::acquire);
          if (curHead == tailCached) {
-            return {};
+            return nullptr;
          }
       }
 
+      return &buffer[curHead];
+   }
+
+   // Hands the slot returned by the last successful Peek back to the producer
+   void Release() {
+      int curHead = head.load(std::memory_order::relaxed);
       head.store(Increment(curHead), std::memory_order::release);
-      return std::move(buffer[curHead]);
+   }
+
+   // Writes as many elements as fit, publishes them with a single tail store. Returns count written
+   int PushN(std::span<const T> data) {
+      int curTail = tail.load(std::memory_order::relaxed);
+      int n = std::min(FreeSlots(curTail, headCached), (int)data.size());
+      if (n < (int)data.size()) {
+         headCached = head.load(std::memory_order::acquire);
+         n = std::min(FreeSlots(curTail, headCached), (int)data.size());
+         if (n == 0) {
+            return 0;
+         }
+      }
+
+      int first = std::min(n, capacity - curTail);
+      std::copy_n(data.begin(), first, buffer.begin() + curTail);
+      std::copy_n(data.begin() + first, n - first, buffer.begin());
+
+      tail.store(Wrap(curTail + n), std::memory_order::release);
+      waitStrategy.Notify(tail);
+      return n;
+   }
+
+   // Reads up to out.size() elements, frees their slots with a single head store. Returns count read
+   int PopN(std::span<T> out) {
+      int curHead = head.load(std::memory_order::relaxed);
+      int n = std::min(UsedSlots(curHead, tailCached), (int)out.size());
+      if (n < (int)out.size()) {
+         tailCached = tail.load(std::memory_order::acquire);
+         n = std::min(UsedSlots(curHead, tailCached), (int)out.size());
+         if (n == 0) {
+            return 0;
+         }
+      }
+
+      int first = std::min(n, capacity - curHead);
+      std::move(buffer.begin() + curHead, buffer.begin() + curHead + first, out.begin());
+      std::move(buffer.begin(), buffer.begin() + (n - first), out.begin() + first);
+
+      head.store(Wrap(curHead + n), std::memory_order::release);
+      return n;
    }
 
    T PopWait() {
-      while (true) {
+      for (int iteration = 0;; iteration = std::min(iteration + 1, kMaxWaitIteration)) {
          if (auto data = Pop()) {
             return data.value();
          }
+         // failed Pop refreshed tailCached
+         waitStrategy.Wait(tail, tailCached, iteration);
       }
    }
 
@@ -71,16 +158,41 @@ private:
    ALIGN_CACHE_LINE int headCached = 0;
    ALIGN_CACHE_LINE int tailCached = 0;
 
+   [[no_unique_address]] WaitStrategy waitStrategy;
+
+   // val in [0, 2 * capacity)
+   int Wrap(int val) const {
+      if constexpr (PowerOfTwoCapacity) {
+         return val & (capacity - 1);
+      } else {
+         return val >= capacity ? val - capacity : val;
+      }
+   }
+
    int Increment(int val) const {
-      int nextVal = val + 1;
-      return nextVal == capacity ? 0 : nextVal;
+      if constexpr (PowerOfTwoCapacity) {
+         return (val + 1) & (capacity - 1);
+      } else {
+         int nextVal = val + 1;
+         return nextVal == capacity ? 0 : nextVal;
+      }
+   }
+
+   // one slot is always kept empty to tell full from empty
+   int FreeSlots(int curTail, int curHead) const {
+      return Wrap(curHead - curTail - 1 + capacity);
+   }
+
+   int UsedSlots(int curHead, int curTail) const {
+      return Wrap(curTail - curHead + capacity);
    }
 };
 
 #include "Helpers.h"
 
-inline bool RingBufferMultiThreadTest(int ringBufferSize, int count, bool emulateWork = false) {
-   RingBuffer<int> rb{ ringBufferSize };
+template<typename WaitStrategy = BusySpinWait>
+bool RingBufferMultiThreadTest(int ringBufferSize, int count, bool emulateWork = false) {
+   RingBuffer<int, false, WaitStrategy> rb{ ringBufferSize };
    int nextExpected = 0;
 
    std::thread writer{
@@ -114,3 +226,41 @@ inline bool RingBufferMultiThreadTest(int ringBufferSize, int count, bool emulat
 
    return nextExpected == count;
 }
+
+// Same as RingBufferMultiThreadTest, but both sides move data with PushN/PopN in batches of batchSize
+inline bool RingBufferBatchMultiThreadTest(int ringBufferSize, int count, int batchSize) {
+   RingBuffer<int> rb{ ringBufferSize };
+   int nextExpected = 0;
+
+   std::thread writer{
+   [&]
+   {
+      std::vector<int> batch(batchSize);
+      int data = 0;
+      while (data < count) {
+         int n = std::min(batchSize, count - data);
+         for (int i = 0; i < n; ++i) {
+            batch[i] = data + i;
+         }
+
+         int written = 0;
+         while (written < n) {
+            written += rb.PushN(std::span<const int>{ batch.data() + written, size_t(n - written) });
+         }
+         data += n;
+      }
+   } };
+
+   std::vector<int> batch(batchSize);
+   bool ok = true;
+   while (nextExpected < count) {
+      int n = rb.PopN(batch);
+      for (int i = 0; i < n; ++i) {
+         ok &= batch[i] == nextExpected++;
+      }
+   }
+
+   writer.join();
+
+   return ok;
+}
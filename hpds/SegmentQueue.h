@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+
+// Unbounded single threaded FIFO, elements live contiguously in linked fixed size segments (4 KB by default).
+// Drained segments go to a free list and are reused, so after warm up Enqueue/Dequeue don't allocate.
+template<typename T, size_t SegmentBytes = 4096>
+class SegmentQueue {
+   struct Segment;
+
+public:
+   SegmentQueue() = default;
+   SegmentQueue(const SegmentQueue&) = delete;
+   SegmentQueue& operator=(const SegmentQueue&) = delete;
+
+   ~SegmentQueue() {
+      Clear();
+      FreeSegments(head);
+      FreeSegments(spare);
+   }
+
+   void Enqueue(const T& data) {
+      if (tailIndex == Segment::kCapacity || !tail) {
+         AppendSegment();
+      }
+      std::construct_at(tail->Item(tailIndex++), data);
+      ++size;
+   }
+
+   std::optional<T> Dequeue() {
+      if (size == 0) {
+         return {};
+      }
+
+      T* item = head->Item(headIndex);
+      std::optional<T> data = std::move(*item);
+      std::destroy_at(item);
+      ++headIndex;
+      --size;
+      AdvanceHead();
+      return data;
+   }
+
+   // Copies segment sized runs, returns data.size()
+   size_t EnqueueN(std::span<const T> data) {
+      size_t done = 0;
+      while (done < data.size()) {
+         if (tailIndex == Segment::kCapacity || !tail) {
+            AppendSegment();
+         }
+         size_t n = std::min(data.size() - done, Segment::kCapacity - tailIndex);
+         std::uninitialized_copy_n(data.begin() + done, n, tail->Item(tailIndex));
+         tailIndex += n;
+         done += n;
+      }
+      size += done;
+      return done;
+   }
+
+   // Moves up to out.size() elements, returns count
+   size_t DequeueN(std::span<T> out) {
+      size_t done = 0;
+      while (done < out.size() && size > 0) {
+         size_t end = head == tail ? tailIndex : Segment::kCapacity;
+         size_t n = std::min(out.size() - done, end - headIndex);
+         T* items = head->Item(headIndex);
+         std::move(items, items + n, out.begin() + done);
+         std::destroy_n(items, n);
+         headIndex += n;
+         size -= n;
+         done += n;
+         AdvanceHead();
+      }
+      return done;
+   }
+
+   const T& Front() const {
+      assert(size > 0);
+      return *head->Item(headIndex);
+   }
+
+   // In FIFO order, a tight loop over each segment
+   template<typename F>
+   void ForEach(F&& f) const {
+      size_t index = headIndex;
+      for (Segment* segment = size ? head : nullptr; segment; segment = segment == tail ? nullptr : segment->next) {
+         size_t end = segment == tail ? tailIndex : Segment::kCapacity;
+         for (; index < end; ++index) {
+            f(*segment->Item(index));
+         }
+         index = 0;
+      }
+   }
+
+   void Clear() {
+      while (size > 0) {
+         std::destroy_at(head->Item(headIndex++));
+         --size;
+         AdvanceHead();
+      }
+   }
+
+   // Frees the recycled segments
+   void ShrinkToFit() {
+      FreeSegments(spare);
+      spare = nullptr;
+   }
+
+   size_t Size() const { return size; }
+   bool Empty() const { return size == 0; }
+
+   static constexpr size_t SegmentCapacity() { return Segment::kCapacity; }
+
+private:
+   struct Segment {
+      static constexpr size_t kHeaderBytes = sizeof(Segment*) > alignof(T) ? sizeof(Segment*) : alignof(T);
+      static constexpr size_t kCapacity = SegmentBytes > kHeaderBytes + sizeof(T) ? (SegmentBytes - kHeaderBytes) / sizeof(T) : 1;
+
+      Segment* next = nullptr;
+      alignas(T) std::byte storage[kCapacity * sizeof(T)];
+
+      T* Item(size_t index) { return reinterpret_cast<T*>(storage) + index; }
+   };
+
+   Segment* head = nullptr;
+   Segment* tail = nullptr;
+   Segment* spare = nullptr; // recycled, singly linked
+   size_t headIndex = 0;
+   size_t tailIndex = 0;
+   size_t size = 0;
+
+   void AppendSegment() {
+      Segment* segment = spare;
+      if (segment) {
+         spare = segment->next;
+      } else {
+         segment = new Segment;
+      }
+      segment->next = nullptr;
+
+      if (tail) {
+         tail->next = segment;
+      } else {
+         head = segment;
+         headIndex = 0;
+      }
+      tail = segment;
+      tailIndex = 0;
+   }
+
+   // Recycles the head segment once it is consumed, rewinds when empty so a single segment is reused in place
+   void AdvanceHead() {
+      if (size == 0) {
+         assert(head == tail);
+         headIndex = 0;
+         tailIndex = 0;
+         return;
+      }
+
+      if (headIndex == Segment::kCapacity) {
+         Segment* consumed = head;
+         head = head->next;
+         headIndex = 0;
+         consumed->next = spare;
+         spare = consumed;
+      }
+   }
+
+   static void FreeSegments(Segment* segment) {
+      while (segment) {
+         Segment* next = segment->next;
+         delete segment;
+         segment = next;
+      }
+   }
+};
@@ -0,0 +1,146 @@
+#include "SharedMemory.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool SharedMemory::Create(const char* segmentName, size_t segmentSize) {
+   Close();
+   if (std::strlen(segmentName) >= sizeof(name) || segmentSize == 0) {
+      return false;
+   }
+
+#ifdef _WIN32
+   HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      DWORD(uint64_t(segmentSize) >> 32), DWORD(segmentSize), segmentName);
+   if (!mapping) {
+      return false;
+   }
+   if (GetLastError() == ERROR_ALREADY_EXISTS) {
+      CloseHandle(mapping);
+      return false;
+   }
+
+   void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, segmentSize);
+   if (!view) {
+      CloseHandle(mapping);
+      return false;
+   }
+   mappingHandle = mapping;
+#else
+   // fails with EEXIST if the name is taken
+   int fd = shm_open(segmentName, O_CREAT | O_EXCL | O_RDWR, 0600);
+   if (fd < 0) {
+      return false;
+   }
+
+   struct stat segmentStat{};
+   void* view = ftruncate(fd, (off_t)segmentSize) == 0 && fstat(fd, &segmentStat) == 0
+      ? mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+      : MAP_FAILED;
+   close(fd);
+   if (view == MAP_FAILED) {
+      shm_unlink(segmentName);
+      return false;
+   }
+   inode = (uint64_t)segmentStat.st_ino;
+#endif
+
+   data = view;
+   size = segmentSize;
+   owner = true;
+   std::strcpy(name, segmentName);
+   return true;
+}
+
+bool SharedMemory::Attach(const char* segmentName) {
+   Close();
+
+#ifdef _WIN32
+   HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, segmentName);
+   if (!mapping) {
+      return false;
+   }
+
+   void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+   MEMORY_BASIC_INFORMATION info{};
+   if (!view || !VirtualQuery(view, &info, sizeof(info))) {
+      if (view) {
+         UnmapViewOfFile(view);
+      }
+      CloseHandle(mapping);
+      return false;
+   }
+   mappingHandle = mapping;
+   size_t segmentSize = info.RegionSize; // rounded up to pages
+#else
+   int fd = shm_open(segmentName, O_RDWR, 0);
+   if (fd < 0) {
+      return false;
+   }
+
+   struct stat segmentStat{};
+   fstat(fd, &segmentStat);
+   size_t segmentSize = (size_t)segmentStat.st_size;
+
+   void* view = segmentSize > 0 ? mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+   close(fd);
+   if (view == MAP_FAILED) {
+      return false;
+   }
+#endif
+
+   data = view;
+   size = segmentSize;
+   owner = false;
+   return true;
+}
+
+void SharedMemory::Close() {
+   if (!data) {
+      return;
+   }
+
+#ifdef _WIN32
+   UnmapViewOfFile(data);
+   CloseHandle(mappingHandle);
+   mappingHandle = nullptr;
+#else
+   munmap(data, size);
+   if (owner) {
+      // the name may have been Removed and taken by a new segment meanwhile
+      int fd = shm_open(name, O_RDONLY, 0);
+      if (fd >= 0) {
+         struct stat segmentStat{};
+         if (fstat(fd, &segmentStat) == 0 && (uint64_t)segmentStat.st_ino == inode) {
+            shm_unlink(name);
+         }
+         close(fd);
+      }
+   }
+   inode = 0;
+#endif
+
+   data = nullptr;
+   size = 0;
+   owner = false;
+   name[0] = '\0';
+}
+
+bool SharedMemory::Remove(const char* segmentName) {
+#ifdef _WIN32
+   (void)segmentName;
+   return true;
+#else
+   return shm_unlink(segmentName) == 0;
+#endif
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Named shared memory segment mapped read-write, POSIX shm_open or a Windows named file mapping.
+// Create fails if the name exists, a live segment is never taken over. A segment left by a crashed creator
+// is removed explicitly with Remove. The creator removes the name on Close, attached processes keep
+// their mapping until they Close.
+class SharedMemory {
+public:
+   SharedMemory() = default;
+   SharedMemory(const SharedMemory&) = delete;
+   SharedMemory& operator=(const SharedMemory&) = delete;
+   ~SharedMemory() { Close(); }
+
+   // Zero filled segment of size bytes, false if the name exists
+   bool Create(const char* name, size_t size);
+   bool Attach(const char* name);
+   void Close();
+
+   // Removes the name of a stale segment, processes that mapped it keep their mapping.
+   // Windows segments go away with the last handle, nothing to remove there
+   static bool Remove(const char* name);
+
+   void* Data() const { return data; }
+   size_t Size() const { return size; }
+
+private:
+   void* data = nullptr;
+   size_t size = 0;
+   char name[256] = {};
+   bool owner = false;
+#ifdef _WIN32
+   void* mappingHandle = nullptr;
+#else
+   uint64_t inode = 0; // Close unlinks the name only if it still refers to this segment
+#endif
+};
@@ -0,0 +1,220 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <type_traits>
+
+#include "CacheLine.h"
+#include "SharedMemory.h"
+
+// Lives at the start of the segment, followed by the element buffer
+struct SharedRingBufferHeader {
+   static constexpr uint64_t kMagic = 0x4252485353445048; // "HPDSSHRB"
+   static constexpr uint32_t kVersion = 1;
+
+   // stored last by the creator, attach fails until the segment is initialized
+   std::atomic<uint64_t> magic;
+   uint32_t version;
+   uint32_t headerSize; // cache line size may differ between builds
+   uint32_t elementSize;
+   uint32_t elementAlign;
+   int32_t capacity;
+
+   ALIGN_CACHE_LINE std::atomic<int> head;
+   ALIGN_CACHE_LINE std::atomic<int> tail;
+};
+
+// RingBuffer between processes: indices and storage live in a named shared memory segment.
+// One process Creates (producer or consumer), the other Attaches, one producer and one consumer in total.
+// Payload must be trivially copyable, layout is checked on attach so mismatched builds don't talk.
+template<typename T>
+class SharedRingBuffer {
+   static_assert(std::is_trivially_copyable_v<T>, "Elements are copied between processes as bytes");
+   static_assert(std::atomic<int>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+      "Atomics in shared memory must be lock free");
+
+public:
+   bool Create(const char* name, int capacity) {
+      Close();
+      if (capacity < 2 || !memory.Create(name, BufferOffset() + size_t(capacity) * sizeof(T))) {
+         return false;
+      }
+
+      header = new (memory.Data()) SharedRingBufferHeader{};
+      header->version = SharedRingBufferHeader::kVersion;
+      header->headerSize = sizeof(SharedRingBufferHeader);
+      header->elementSize = sizeof(T);
+      header->elementAlign = alignof(T);
+      header->capacity = capacity;
+      header->magic.store(SharedRingBufferHeader::kMagic, std::memory_order::release);
+
+      Map();
+      return true;
+   }
+
+   // false if the segment doesn't exist, isn't initialized yet or was created for another layout
+   bool Attach(const char* name) {
+      Close();
+      if (!memory.Attach(name) || memory.Size() < sizeof(SharedRingBufferHeader)) {
+         Close();
+         return false;
+      }
+
+      header = static_cast<SharedRingBufferHeader*>(memory.Data());
+      if (header->magic.load(std::memory_order::acquire) != SharedRingBufferHeader::kMagic
+         || header->version != SharedRingBufferHeader::kVersion
+         || header->headerSize != sizeof(SharedRingBufferHeader)
+         || header->elementSize != sizeof(T) || header->elementAlign != alignof(T)
+         || header->capacity < 2 || memory.Size() < BufferOffset() + size_t(header->capacity) * sizeof(T)) {
+         Close();
+         return false;
+      }
+
+      Map();
+      return true;
+   }
+
+   void Close() {
+      memory.Close();
+      header = nullptr;
+      buffer = nullptr;
+      capacity = 0;
+   }
+
+   bool Push(const T& data) {
+      int curTail = header->tail.load(std::memory_order::relaxed);
+      int nextTail = Increment(curTail);
+
+      if (nextTail == headCached) {
+         headCached = header->head.load(std::memory_order::acquire);
+         if (nextTail == headCached) {
+            return false;
+         }
+      }
+
+      buffer[curTail] = data;
+      header->tail.store(nextTail, std::memory_order::release);
+      return true;
+   }
+
+   std::optional<T> Pop() {
+      int curHead = header->head.load(std::memory_order::relaxed);
+      if (curHead == tailCached) {
+         tailCached = header->tail.load(std::memory_order::acquire);
+         if (curHead == tailCached) {
+            return {};
+         }
+      }
+
+      T data = buffer[curHead];
+      header->head.store(Increment(curHead), std::memory_order::release);
+      return data;
+   }
+
+   T PopWait() {
+      while (true) {
+         if (auto data = Pop()) {
+            return data.value();
+         }
+      }
+   }
+
+   bool WasEmpty() const {
+      return header->tail == header->head;
+   }
+
+   bool WasFull() const {
+      return Increment(header->tail) == header->head;
+   }
+
+   int Capacity() const {
+      return capacity;
+   }
+
+private:
+   SharedMemory memory;
+   SharedRingBufferHeader* header = nullptr;
+   T* buffer = nullptr;
+   int capacity = 0;
+
+   // process local, same as in RingBuffer
+   ALIGN_CACHE_LINE int headCached = 0;
+   ALIGN_CACHE_LINE int tailCached = 0;
+
+   static constexpr size_t BufferOffset() {
+      constexpr size_t align = alignof(T) > alignof(SharedRingBufferHeader) ? alignof(T) : alignof(SharedRingBufferHeader);
+      return (sizeof(SharedRingBufferHeader) + align - 1) / align * align;
+   }
+
+   void Map() {
+      buffer = reinterpret_cast<T*>(static_cast<char*>(memory.Data()) + BufferOffset());
+      capacity = header->capacity;
+      headCached = header->head.load(std::memory_order::acquire);
+      tailCached = header->tail.load(std::memory_order::acquire);
+   }
+
+   int Increment(int val) const {
+      int nextVal = val + 1;
+      return nextVal == capacity ? 0 : nextVal;
+   }
+};
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Forks a producer process that attaches by name, this process consumes and checks the sequence
+inline bool SharedRingBufferMultiProcessTest(const char* name, int ringBufferSize, int count) {
+   // a killed earlier run may have left the segment
+   SharedMemory::Remove(name);
+
+   SharedRingBuffer<int> rb;
+   if (!rb.Create(name, ringBufferSize)) {
+      return false;
+   }
+
+   pid_t producer = fork();
+   if (producer < 0) {
+      return false;
+   }
+   if (producer == 0) {
+      SharedRingBuffer<int> writer;
+      if (!writer.Attach(name)) {
+         _exit(1);
+      }
+      for (int data = 0; data < count; ++data) {
+         while (!writer.Push(data));
+      }
+      _exit(0);
+   }
+
+   int nextExpected = 0;
+   int status = 0;
+   bool exited = false;
+   int emptyPolls = 0;
+   while (nextExpected < count) {
+      if (auto data = rb.Pop()) {
+         if (*data != nextExpected) {
+            break;
+         }
+         ++nextExpected;
+      } else if (exited) {
+         // producer is gone and the ring is drained
+         break;
+      } else if (++emptyPolls % 4096 == 0) {
+         exited = waitpid(producer, &status, WNOHANG) == producer;
+      }
+   }
+
+   if (!exited) {
+      if (nextExpected < count) {
+         kill(producer, SIGKILL);
+      }
+      waitpid(producer, &status, 0);
+   }
+
+   return nextExpected == count && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
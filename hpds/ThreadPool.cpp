@@ -0,0 +1,162 @@
+#include "ThreadPool.h"
+
+#include <immintrin.h>
+
+thread_local ThreadPool::Worker* ThreadPool::currentWorker = nullptr;
+
+namespace {
+   constexpr int kSpinsBeforePark = 256;
+
+   uint32_t XorShift(uint32_t& state) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return state;
+   }
+}
+
+ThreadPool::ThreadPool(int nWorkers) : tasks(std::make_unique<Task[]>(kMaxPendingTasks)) {
+   nWorkers = std::max(nWorkers, 1);
+   for (int i = 0; i < nWorkers; ++i) {
+      auto worker = std::make_unique<Worker>(this);
+      worker->randomState = uint32_t(i) * 2654435761u + 1;
+      workers.push_back(std::move(worker));
+   }
+   for (auto& worker : workers) {
+      worker->thread = std::thread{ [this, self = worker.get()] { WorkerLoop(self); } };
+   }
+}
+
+ThreadPool::~ThreadPool() {
+   stop.store(true, std::memory_order::seq_cst);
+   wakeEpoch.fetch_add(1, std::memory_order::seq_cst);
+   wakeEpoch.notify_all();
+
+   for (auto& worker : workers) {
+      worker->thread.join();
+   }
+}
+
+ThreadPool::Task* ThreadPool::AllocateTask() {
+   Worker* self = CurrentWorker();
+   int slot = self ? self->taskCache.Allocate() : taskSlots.Allocate();
+   return slot >= 0 ? &tasks[slot] : nullptr;
+}
+
+void ThreadPool::Push(Task* task) {
+   if (Worker* self = CurrentWorker()) {
+      self->deque.Push(task);
+   } else {
+      std::lock_guard lock{ injectedMutex };
+      injected.Enqueue(task);
+      injectedCount.fetch_add(1, std::memory_order::relaxed);
+   }
+
+   // pairs with the fence in WorkerLoop: either a parking worker sees the task or we see it parking
+   std::atomic_thread_fence(std::memory_order::seq_cst);
+   if (sleepers.load(std::memory_order::relaxed) > 0) {
+      wakeEpoch.fetch_add(1, std::memory_order::release);
+      wakeEpoch.notify_one();
+   }
+}
+
+ThreadPool::Task* ThreadPool::FindTask(Worker* self) {
+   if (self) {
+      if (auto task = self->deque.Pop()) {
+         return *task;
+      }
+   }
+
+   if (injectedCount.load(std::memory_order::relaxed) > 0) {
+      std::lock_guard lock{ injectedMutex };
+      if (auto task = injected.Dequeue()) {
+         injectedCount.fetch_sub(1, std::memory_order::relaxed);
+         return *task;
+      }
+   }
+
+   // random first victim so thieves spread over workers
+   int nWorkers = (int)workers.size();
+   uint32_t random = self ? XorShift(self->randomState) : 0;
+   for (int i = 0; i < nWorkers; ++i) {
+      Worker* victim = workers[(random + i) % nWorkers].get();
+      if (victim == self) {
+         continue;
+      }
+      if (auto task = victim->deque.Steal()) {
+         return *task;
+      }
+   }
+   return nullptr;
+}
+
+void ThreadPool::Execute(Task* task) {
+   TaskGroup* group = task->group;
+   task->run(task->storage);
+
+   // slot goes back before pending drops, a finished group may destroy the pool
+   int slot = int(task - tasks.get());
+   if (Worker* self = CurrentWorker()) {
+      self->taskCache.Free(slot);
+   } else {
+      taskSlots.Free(slot);
+   }
+   group->pending.fetch_sub(1, std::memory_order::release);
+}
+
+bool ThreadPool::HasWork() const {
+   if (injectedCount.load(std::memory_order::relaxed) > 0) {
+      return true;
+   }
+   for (const auto& worker : workers) {
+      if (worker->deque.Size() > 0) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void ThreadPool::WorkerLoop(Worker* self) {
+   currentWorker = self;
+
+   int idleSpins = 0;
+   while (!stop.load(std::memory_order::relaxed)) {
+      if (Task* task = FindTask(self)) {
+         Execute(task);
+         idleSpins = 0;
+         continue;
+      }
+
+      if (++idleSpins < kSpinsBeforePark) {
+         _mm_pause();
+         continue;
+      }
+
+      uint32_t epoch = wakeEpoch.load(std::memory_order::acquire);
+      sleepers.fetch_add(1, std::memory_order::relaxed);
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (!HasWork() && !stop.load(std::memory_order::relaxed)) {
+         wakeEpoch.wait(epoch, std::memory_order::acquire);
+      }
+      sleepers.fetch_sub(1, std::memory_order::relaxed);
+      idleSpins = 0;
+   }
+
+   currentWorker = nullptr;
+}
+
+void TaskGroup::Wait() {
+   ThreadPool::Worker* self = pool.CurrentWorker();
+   int idleSpins = 0;
+   while (pending.load(std::memory_order::acquire) > 0) {
+      if (ThreadPool::Task* task = pool.FindTask(self)) {
+         pool.Execute(task);
+         idleSpins = 0;
+      } else if (++idleSpins < kSpinsBeforePark) {
+         _mm_pause();
+      } else {
+         // remaining tasks run on other threads
+         std::this_thread::yield();
+      }
+   }
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "CacheLine.h"
+#include "ConcurrentIndexPool.h"
+#include "SegmentQueue.h"
+#include "WorkStealingDeque.h"
+
+class TaskGroup;
+
+// Work stealing scheduler: a Chase-Lev deque per worker, tasks spawned on a worker go to its own deque,
+// tasks from other threads to a shared injection queue. Idle workers steal from random victims, then park.
+// Threads waiting on a TaskGroup run tasks meanwhile, so fork/join never blocks a worker.
+// Tasks live in a fixed slab: callables up to Task::kInlineSize bytes are stored in place and slots come
+// from a ConcurrentIndexPool with a magazine per worker, so spawning does not allocate.
+class ThreadPool {
+public:
+   static constexpr int kMaxPendingTasks = 1 << 14;
+
+   explicit ThreadPool(int nWorkers = (int)std::thread::hardware_concurrency());
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool& operator=(const ThreadPool&) = delete;
+   // Tasks must be waited for before
+   ~ThreadPool();
+
+   int Workers() const { return (int)workers.size(); }
+
+   // f(i) for i in [begin, end), the range is split in halves down to grain indices per task. Calling thread helps
+   template<typename F>
+   void ParallelFor(int begin, int end, int grain, F&& f);
+
+private:
+   friend class TaskGroup;
+
+   // One cache line. Bigger callables are moved to the heap, capture by reference to stay inline
+   struct ALIGN_CACHE_LINE Task {
+      static constexpr size_t kInlineSize = 48;
+
+      alignas(std::max_align_t) unsigned char storage[kInlineSize];
+      void (*run)(void* storage); // calls and destroys the callable
+      TaskGroup* group;
+
+      template<typename F>
+      void Emplace(F&& f) {
+         using Fn = std::decay_t<F>;
+         if constexpr (sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t)) {
+            new (storage) Fn(std::forward<F>(f));
+            run = [](void* storage) {
+               Fn& fn = *std::launder(reinterpret_cast<Fn*>(storage));
+               fn();
+               fn.~Fn();
+            };
+         } else {
+            new (storage) Fn*(new Fn(std::forward<F>(f)));
+            run = [](void* storage) {
+               Fn* fn = *std::launder(reinterpret_cast<Fn**>(storage));
+               (*fn)();
+               delete fn;
+            };
+         }
+      }
+   };
+
+   struct Worker {
+      explicit Worker(ThreadPool* pool) : pool(pool), taskCache(pool->taskSlots) {}
+
+      WorkStealingDeque<Task*> deque;
+      ThreadPool* pool;
+      ConcurrentIndexPool::ThreadCache taskCache;
+      uint32_t randomState;
+      std::thread thread;
+   };
+
+   // outlive workers, their caches return slots on destruction
+   std::unique_ptr<Task[]> tasks;
+   ConcurrentIndexPool taskSlots{ kMaxPendingTasks };
+
+   std::vector<std::unique_ptr<Worker>> workers;
+
+   std::mutex injectedMutex;
+   SegmentQueue<Task*> injected;
+   std::atomic<int> injectedCount = 0;
+
+   ALIGN_CACHE_LINE std::atomic<uint32_t> wakeEpoch = 0;
+   std::atomic<int> sleepers = 0;
+   std::atomic<bool> stop = false;
+
+   static thread_local Worker* currentWorker;
+
+   Worker* CurrentWorker() const {
+      return currentWorker && currentWorker->pool == this ? currentWorker : nullptr;
+   }
+
+   // nullptr if all slots are pending
+   Task* AllocateTask();
+   void Push(Task* task);
+   Task* FindTask(Worker* self);
+   void Execute(Task* task);
+   bool HasWork() const;
+   void WorkerLoop(Worker* self);
+
+   template<typename F>
+   static void SplitRange(TaskGroup& group, int begin, int end, int grain, F& f);
+};
+
+// Fork/join scope: Run spawns, Wait (also in destructor) returns when all spawned tasks finished
+class TaskGroup {
+public:
+   explicit TaskGroup(ThreadPool& pool) : pool(pool) {}
+   TaskGroup(const TaskGroup&) = delete;
+   TaskGroup& operator=(const TaskGroup&) = delete;
+   ~TaskGroup() { Wait(); }
+
+   // Runs f in place when ThreadPool::kMaxPendingTasks tasks are already pending
+   template<typename F>
+   void Run(F&& f) {
+      ThreadPool::Task* task = pool.AllocateTask();
+      if (!task) {
+         std::forward<F>(f)();
+         return;
+      }
+
+      task->Emplace(std::forward<F>(f));
+      task->group = this;
+      pending.fetch_add(1, std::memory_order::relaxed);
+      pool.Push(task);
+   }
+
+   void Wait();
+
+private:
+   friend class ThreadPool;
+
+   ThreadPool& pool;
+   std::atomic<int> pending = 0;
+};
+
+template<typename F>
+void ThreadPool::SplitRange(TaskGroup& group, int begin, int end, int grain, F& f) {
+   // spawn the upper half and keep splitting the lower one, thieves take the biggest halves first
+   while (end - begin > grain) {
+      int mid = begin + (end - begin) / 2;
+      group.Run([&group, &f, mid, end, grain] { SplitRange(group, mid, end, grain, f); });
+      end = mid;
+   }
+   for (int i = begin; i < end; ++i) {
+      f(i);
+   }
+}
+
+template<typename F>
+void ThreadPool::ParallelFor(int begin, int end, int grain, F&& f) {
+   TaskGroup group{ *this };
+   SplitRange(group, begin, end, std::max(grain, 1), f);
+   group.Wait();
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <immintrin.h>
+#include <thread>
+
+#include "CacheLine.h"
+
+// How a consumer waits for the producer to publish, plugged into RingBuffer.
+// Wait is called in a loop while value still equals observed, iteration counts the failed attempts
+// and saturates at kMaxWaitIteration, every strategy reaches its slowest step before that.
+// Notify is called by the producer after each publish of value.
+constexpr int kMaxWaitIteration = 1 << 10;
+
+// Lowest latency, burns the core and starves the hyper-thread sibling
+struct BusySpinWait {
+   void Wait(const std::atomic<int>&, int, int) {}
+   void Notify(std::atomic<int>&) {}
+};
+
+// Exponential backoff of PAUSE instructions, frees pipeline resources for the sibling
+struct PauseBackoffWait {
+   static constexpr int kMaxPauses = 64;
+
+   void Wait(const std::atomic<int>&, int, int iteration) {
+      int pauses = 1 << std::min(iteration, std::countr_zero(unsigned(kMaxPauses)));
+      for (int i = 0; i < pauses; ++i) {
+         _mm_pause();
+      }
+   }
+
+   void Notify(std::atomic<int>&) {}
+};
+
+// Spins shortly then gives the core to other runnable threads, still 100% cpu when idle
+struct YieldWait {
+   static constexpr int kSpins = 64;
+   static_assert(kSpins < kMaxWaitIteration);
+
+   void Wait(const std::atomic<int>&, int, int iteration) {
+      if (iteration < kSpins) {
+         _mm_pause();
+      } else {
+         std::this_thread::yield();
+      }
+   }
+
+   void Notify(std::atomic<int>&) {}
+};
+
+// Spins shortly then sleeps in the kernel (futex) until the producer notifies. No cpu when idle,
+// wake-up costs a syscall on both sides. Producer pays a full fence per publish to see the sleeping flag
+struct ParkWait {
+   static constexpr int kSpins = 256;
+   static_assert(kSpins < kMaxWaitIteration);
+
+   void Wait(const std::atomic<int>& value, int observed, int iteration) {
+      if (iteration < kSpins) {
+         _mm_pause();
+         return;
+      }
+
+      // Dekker style handshake with Notify: either the producer sees sleeping or we see the new value
+      sleeping.store(true, std::memory_order::relaxed);
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (value.load(std::memory_order::relaxed) == observed) {
+         value.wait(observed, std::memory_order::acquire);
+      }
+      sleeping.store(false, std::memory_order::relaxed);
+   }
+
+   void Notify(std::atomic<int>& value) {
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (sleeping.load(std::memory_order::relaxed)) {
+         value.notify_one();
+      }
+   }
+
+private:
+   ALIGN_CACHE_LINE std::atomic<bool> sleeping = false;
+};
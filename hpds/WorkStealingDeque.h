@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "CacheLine.h"
+
+// Chase-Lev work stealing deque, memory orders from "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al.).
+// Owner thread pushes and pops at the bottom (LIFO, cache warm), any thread steals from the top (FIFO, oldest and usually biggest work).
+// Grows when full, old arrays are kept until destruction because a thief may still read them.
+template<typename T>
+class WorkStealingDeque {
+   static_assert(std::is_trivially_copyable_v<T>, "Elements are read racily by thieves, use pointers or indices");
+
+public:
+   WorkStealingDeque(int capacity = 256) {
+      assert(std::has_single_bit((unsigned)capacity));
+      arrays.push_back(std::make_unique<Array>(capacity));
+      array.store(arrays.back().get(), std::memory_order::relaxed);
+   }
+
+   // Owner only
+   void Push(T item) {
+      int64_t b = bottom.load(std::memory_order::relaxed);
+      int64_t t = top.load(std::memory_order::acquire);
+      Array* a = array.load(std::memory_order::relaxed);
+      if (b - t > a->mask) {
+         a = Grow(a, t, b);
+      }
+      a->Store(b, item);
+      // release store instead of the paper's release fence + relaxed store, same code on x86 and visible to TSan
+      bottom.store(b + 1, std::memory_order::release);
+   }
+
+   // Owner only
+   std::optional<T> Pop() {
+      int64_t b = bottom.load(std::memory_order::relaxed) - 1;
+      Array* a = array.load(std::memory_order::relaxed);
+      bottom.store(b, std::memory_order::relaxed);
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      int64_t t = top.load(std::memory_order::relaxed);
+
+      if (t > b) {
+         bottom.store(b + 1, std::memory_order::relaxed);
+         return {};
+      }
+
+      T item = a->Load(b);
+      if (t == b) {
+         // last element, race with thieves for it
+         bool won = top.compare_exchange_strong(t, t + 1, std::memory_order::seq_cst, std::memory_order::relaxed);
+         bottom.store(b + 1, std::memory_order::relaxed);
+         if (!won) {
+            return {};
+         }
+      }
+      return item;
+   }
+
+   // Any thread. Empty result also when lost a race, caller just tries elsewhere
+   std::optional<T> Steal() {
+      int64_t t = top.load(std::memory_order::acquire);
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      int64_t b = bottom.load(std::memory_order::acquire);
+
+      if (t >= b) {
+         return {};
+      }
+
+      Array* a = array.load(std::memory_order::acquire);
+      T item = a->Load(t);
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order::seq_cst, std::memory_order::relaxed)) {
+         return {};
+      }
+      return item;
+   }
+
+   // Approximate when called concurrently
+   int64_t Size() const {
+      int64_t b = bottom.load(std::memory_order::relaxed);
+      int64_t t = top.load(std::memory_order::relaxed);
+      return b > t ? b - t : 0;
+   }
+
+private:
+   struct Array {
+      int64_t mask;
+      std::unique_ptr<std::atomic<T>[]> items;
+
+      Array(int64_t capacity) : mask(capacity - 1), items(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+      T Load(int64_t index) const { return items[index & mask].load(std::memory_order::relaxed); }
+      void Store(int64_t index, T item) { items[index & mask].store(item, std::memory_order::relaxed); }
+   };
+
+   ALIGN_CACHE_LINE std::atomic<int64_t> top = 0;
+   ALIGN_CACHE_LINE std::atomic<int64_t> bottom = 0;
+   std::atomic<Array*> array;
+   std::vector<std::unique_ptr<Array>> arrays; // owner only
+
+   Array* Grow(Array* old, int64_t t, int64_t b) {
+      arrays.push_back(std::make_unique<Array>((old->mask + 1) * 2));
+      Array* grown = arrays.back().get();
+      for (int64_t i = t; i < b; ++i) {
+         grown->Store(i, old->Load(i));
+      }
+      array.store(grown, std::memory_order::release);
+      return grown;
+   }
+};
@@ -1,3 +1,8 @@
+newoption {
+    trigger = "avx2",
+    description = "Compile with AVX2, binaries then need an AVX2 capable CPU"
+}
+
 workspace "hpds"
     configurations { "Debug", "Release" }
     flags { "MultiProcessorCompile" }
@@ -5,6 +10,10 @@ workspace "hpds"
     systemversion "latest"
     cppdialect "C++20"
 
+    -- OccupancyBitmap scans its summary 4 words at a time with AVX2, scalar loop otherwise
+    filter { "options:avx2" }
+        vectorextensions "AVX2"
+
     filter { "configurations:Debug" }
         defines { "DEBUG" }
         symbols "On"
@@ -17,6 +26,7 @@ workspace "hpds"
         libdirs { "bin/linux", "/usr/local/lib"  }
         buildoptions "-std=c++11"
         linkoptions "-pthread"
+        links { "rt" }
 
     startproject "test"
 
@@ -39,10 +39,79 @@ TEST(RingBuffer, SingleThread) {
    ASSERT_FALSE(rb.Pop().has_value());
 }
 
+TEST(RingBuffer, Batch) {
+   RingBuffer<int> rb{5};
+   int in[] = { 0, 1, 2, 3, 4, 5 };
+   int out[6] = {};
+
+   ASSERT_EQ(rb.PushN(in), 4);
+   ASSERT_EQ(rb.PopN(std::span{ out, 3 }), 3);
+   ASSERT_EQ(out[0], 0);
+   ASSERT_EQ(out[2], 2);
+
+   // wraps around the end of the buffer
+   ASSERT_EQ(rb.PushN(std::span{ in + 4, 2 }), 2);
+   ASSERT_EQ(rb.PushN(in), 1);
+   ASSERT_TRUE(rb.WasFull());
+
+   ASSERT_EQ(rb.PopN(out), 4);
+   ASSERT_EQ(out[0], 3);
+   ASSERT_EQ(out[1], 4);
+   ASSERT_EQ(out[2], 5);
+   ASSERT_EQ(out[3], 0);
+   ASSERT_EQ(rb.PopN(out), 0);
+   ASSERT_TRUE(rb.WasEmpty());
+}
+
+TEST(RingBuffer, ClaimPeek) {
+   RingBuffer<std::vector<int>, true> rb{4};
+
+   for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 3; ++i) {
+         std::vector<int>* slot = rb.TryClaim();
+         ASSERT_NE(slot, nullptr);
+         slot->assign(i + 1, round);
+         rb.Commit();
+      }
+      ASSERT_EQ(rb.TryClaim(), nullptr);
+      ASSERT_TRUE(rb.WasFull());
+
+      for (int i = 0; i < 3; ++i) {
+         std::vector<int>* slot = rb.Peek();
+         ASSERT_NE(slot, nullptr);
+         ASSERT_EQ(slot->size(), i + 1);
+         ASSERT_EQ(slot->front(), round);
+         rb.Release();
+      }
+      ASSERT_EQ(rb.Peek(), nullptr);
+   }
+
+   int in[] = { 0, 1, 2 };
+   int out[3] = {};
+   RingBuffer<int, true> masked{4};
+   ASSERT_EQ(masked.PushN(std::span{ in, 2 }), 2);
+   ASSERT_EQ(masked.PopN(out), 2);
+   ASSERT_EQ(masked.PushN(in), 3); // wraps
+   ASSERT_EQ(masked.PopN(out), 3);
+   ASSERT_EQ(out[2], 2);
+}
+
 TEST(RingBuffer, MultiThreaded) {
    ASSERT_TRUE(RingBufferMultiThreadTest(10, 10'000'000));
 }
 
+TEST(RingBuffer, WaitStrategies) {
+   ASSERT_TRUE(RingBufferMultiThreadTest<PauseBackoffWait>(1024, 100'000));
+   ASSERT_TRUE(RingBufferMultiThreadTest<YieldWait>(1024, 100'000));
+   ASSERT_TRUE(RingBufferMultiThreadTest<ParkWait>(1024, 100'000));
+   ASSERT_TRUE(RingBufferMultiThreadTest<ParkWait>(4, 1'000, true));
+}
+
+TEST(RingBuffer, BatchMultiThreaded) {
+   ASSERT_TRUE(RingBufferBatchMultiThreadTest(64, 100'000, 8));
+   ASSERT_TRUE(RingBufferBatchMultiThreadTest(1024, 1'000'000, 64));
+}
+
 TEST(IndexPool, Basic) {
    IndexPool pool{ 3 };
    ASSERT_EQ(pool.Available(), 3);
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "BroadcastRing.h"
+
+TEST(BroadcastRing, SingleThread) {
+   BroadcastRing<int> ring{ 4 };
+   int journal = ring.AddConsumer();
+   int risk = ring.AddConsumer();
+   int matcher = ring.AddConsumer({ risk });
+
+   for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(ring.Push(i));
+   }
+   ASSERT_FALSE(ring.Push(4));
+
+   // matcher waits for risk
+   ASSERT_EQ(ring.Peek(matcher), nullptr);
+   ASSERT_EQ(*ring.Peek(risk), 0);
+   ring.Release(risk);
+   ASSERT_EQ(*ring.Peek(matcher), 0);
+   ring.Release(matcher);
+   ASSERT_EQ(ring.Peek(matcher), nullptr);
+
+   // slowest consumer gates the producer
+   ASSERT_FALSE(ring.Push(4));
+   for (int i = 0; i < 4; ++i) {
+      ASSERT_EQ(*ring.Peek(journal), i);
+      ring.Release(journal);
+   }
+   ASSERT_EQ(ring.Peek(journal), nullptr);
+   ASSERT_TRUE(ring.Push(4));
+   ASSERT_FALSE(ring.Push(5));
+}
+
+TEST(BroadcastRing, MultiThreaded) {
+   constexpr int count = 100'000;
+   BroadcastRing<int> ring{ 64 };
+   int first = ring.AddConsumer();
+   int second = ring.AddConsumer();
+   int last = ring.AddConsumer({ first, second });
+
+   std::vector<int> stage(count, 0);
+   std::atomic<bool> ok = true;
+
+   auto Consume = [&](int consumer, bool markStage, bool checkStage) {
+      for (int i = 0; i < count; ++i) {
+         const int* data;
+         while (!(data = ring.Peek(consumer))) {
+            std::this_thread::yield();
+         }
+         if (*data != i) {
+            ok = false;
+         }
+         if (markStage) {
+            // released before the dependent stage may see it
+            stage[*data] = 1;
+         }
+         if (checkStage && stage[*data] != 1) {
+            ok = false;
+         }
+         ring.Release(consumer);
+      }
+   };
+
+   std::thread firstThread{ [&] { Consume(first, true, false); } };
+   std::thread secondThread{ [&] { Consume(second, false, false); } };
+   std::thread lastThread{ [&] { Consume(last, false, true); } };
+
+   for (int i = 0; i < count; ++i) {
+      while (!ring.Push(i)) {
+         std::this_thread::yield();
+      }
+   }
+
+   firstThread.join();
+   secondThread.join();
+   lastThread.join();
+   ASSERT_TRUE(ok);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+
+#include "ByteRing.h"
+
+TEST(ByteRing, WrapAround) {
+   ByteRing ring{ 64 };
+   ASSERT_EQ(ring.Peek(), nullptr);
+
+   // 8 + 13 -> 24 bytes each
+   char message[13] = "hello";
+   ASSERT_TRUE(ring.Write(1, message, sizeof(message)));
+   ASSERT_TRUE(ring.Write(2, message, sizeof(message)));
+   ASSERT_FALSE(ring.Write(3, message, 9));
+
+   const ByteRingRecord* record = ring.Peek();
+   ASSERT_NE(record, nullptr);
+   ASSERT_EQ(record->type, 1);
+   ASSERT_EQ(record->size, sizeof(message));
+   ASSERT_STREQ((const char*)record->Data(), "hello");
+   ring.Release();
+
+   // 32 bytes don't fit in the last 16 before the end, needs padding and the start which is still taken
+   ASSERT_EQ(ring.TryClaim(4, 24), nullptr);
+   ASSERT_EQ(ring.Peek()->type, 2);
+   ring.Release();
+   ASSERT_TRUE(ring.WasEmpty());
+
+   std::byte* payload = ring.TryClaim(4, 24);
+   ASSERT_NE(payload, nullptr);
+   ASSERT_EQ((uintptr_t)payload % ByteRing::kAlignment, 0);
+   std::memset(payload, 7, 24);
+   ring.Commit();
+
+   // padding is skipped
+   record = ring.Peek();
+   ASSERT_EQ(record->type, 4);
+   ASSERT_EQ(record->size, 24);
+   ASSERT_EQ((const void*)record->Data(), (const void*)payload);
+   ASSERT_EQ(record->Data()[23], std::byte{ 7 });
+   ring.Release();
+   ASSERT_EQ(ring.Peek(), nullptr);
+   ASSERT_TRUE(ring.WasEmpty());
+}
+
+// Largest record is claimed at any tail position once the ring is empty
+TEST(ByteRing, LargestRecord) {
+   ByteRing ring{ 64 };
+   ASSERT_EQ(ring.MaxPayloadSize(), 24);
+   ASSERT_EQ(ByteRing::RecordSize(ring.MaxPayloadSize()), 32);
+
+   // tail at 40, 24 bytes left before the end
+   char data[24] = {};
+   ASSERT_TRUE(ring.Write(1, data, 8));
+   ASSERT_TRUE(ring.Write(2, data, 16));
+   for (int i = 0; i < 2; ++i) {
+      ASSERT_NE(ring.Peek(), nullptr);
+      ring.Release();
+   }
+
+   for (int round = 0; round < 8; ++round) {
+      ASSERT_TRUE(ring.Write(3, data, sizeof(data)));
+      const ByteRingRecord* record = ring.Peek();
+      ASSERT_NE(record, nullptr);
+      ASSERT_EQ(record->size, sizeof(data));
+      ring.Release();
+      ASSERT_TRUE(ring.WasEmpty());
+   }
+}
+
+TEST(ByteRing, MultiThreaded) {
+   constexpr int count = 100'000;
+   ByteRing ring{ 1024 };
+
+   std::thread writer{ [&] {
+      std::byte data[100];
+      for (int i = 0; i < count; ++i) {
+         uint32_t size = i % 97;
+         std::memset(data, i & 0xff, size);
+         while (!ring.Write(i, data, size)) {
+            std::this_thread::yield();
+         }
+      }
+   } };
+
+   bool ok = true;
+   for (int i = 0; i < count; ++i) {
+      const ByteRingRecord* record;
+      while (!(record = ring.Peek())) {
+         std::this_thread::yield();
+      }
+      ok &= record->type == (uint32_t)i && record->size == uint32_t(i % 97);
+      for (uint32_t b = 0; b < record->size; ++b) {
+         ok &= record->Data()[b] == std::byte(i & 0xff);
+      }
+      ring.Release();
+   }
+
+   writer.join();
+   ASSERT_TRUE(ok);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <thread>
+
+#include "ConcurrentIndexPool.h"
+
+TEST(ConcurrentIndexPool, SingleThread) {
+   ConcurrentIndexPool pool{ 100 };
+   std::vector<int> allocated;
+   {
+      ConcurrentIndexPool::ThreadCache cache{ pool };
+      for (int i = 0; i < 30; ++i) {
+         allocated.push_back(pool.Allocate());
+      }
+      for (int i = 0; i < 70; ++i) {
+         allocated.push_back(cache.Allocate());
+      }
+      ASSERT_EQ(allocated[0], 0);
+      ASSERT_EQ(allocated[30], 30);
+      ASSERT_EQ(pool.Allocate(), -1);
+      ASSERT_EQ(cache.Allocate(), -1);
+
+      std::vector<int> sorted = allocated;
+      std::sort(sorted.begin(), sorted.end());
+      for (int i = 0; i < 100; ++i) {
+         ASSERT_EQ(sorted[i], i);
+      }
+
+      // freed through the cache and directly, cached ones return to the pool with the cache
+      for (int i = 0; i < 100; ++i) {
+         if (i % 2) {
+            cache.Free(allocated[i]);
+         } else {
+            pool.Free(allocated[i]);
+         }
+      }
+   }
+
+   std::vector<int> again;
+   for (int i = 0; i < 100; ++i) {
+      again.push_back(pool.Allocate());
+   }
+   ASSERT_EQ(pool.Allocate(), -1);
+   std::sort(again.begin(), again.end());
+   for (int i = 0; i < 100; ++i) {
+      ASSERT_EQ(again[i], i);
+   }
+}
+
+TEST(ConcurrentIndexPool, MultiThreaded) {
+   constexpr int nThreads = 4;
+   constexpr int capacity = 1024;
+   ConcurrentIndexPool pool{ capacity };
+   std::vector<std::atomic<bool>> owned(capacity);
+   std::atomic<bool> ok = true;
+
+   std::vector<std::thread> threads;
+   for (int t = 0; t < nThreads; ++t) {
+      threads.emplace_back([&, t] {
+         ConcurrentIndexPool::ThreadCache cache{ pool };
+         std::vector<int> held;
+         for (int i = 0; i < 200'000; ++i) {
+            // odd threads go around the cache
+            bool cached = t % 2 == 0;
+            if (held.size() < 100 && (held.empty() || i % 3 != 0)) {
+               int index = cached ? cache.Allocate() : pool.Allocate();
+               if (index < 0 || owned[index].exchange(true)) {
+                  ok = false;
+               }
+               held.push_back(index);
+            } else {
+               int index = held.back();
+               held.pop_back();
+               owned[index] = false;
+               cached ? cache.Free(index) : pool.Free(index);
+            }
+         }
+         for (int index : held) {
+            owned[index] = false;
+            cache.Free(index);
+         }
+      });
+   }
+   for (auto& thread : threads) {
+      thread.join();
+   }
+   ASSERT_TRUE(ok);
+
+   // nothing leaked
+   int count = 0;
+   while (pool.Allocate() >= 0) {
+      ++count;
+   }
+   ASSERT_EQ(count, capacity);
+}
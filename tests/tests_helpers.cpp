@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <climits>
+
+#include "Helpers.h"
+
+TEST(OrderFlow, Deterministic) {
+   OrderFlowConfig config;
+   config.seed = 42;
+   auto a = GenerateOrderFlow(10'000, config);
+   auto b = GenerateOrderFlow(10'000, config);
+   ASSERT_EQ(a, b);
+
+   config.seed = 43;
+   auto c = GenerateOrderFlow(10'000, config);
+   ASSERT_NE(a, c);
+}
+
+TEST(OrderFlow, Events) {
+   OrderFlowConfig config;
+   auto events = GenerateOrderFlow(100'000, config);
+
+   int nAdds = 0;
+   int nCancels = 0;
+   std::vector<bool> canceled;
+   for (const auto& event : events) {
+      switch (event.type) {
+         case OrderFlowEvent::Type::Add:
+            ASSERT_EQ(event.orderId, nAdds++);
+            ASSERT_GE(event.quantity, config.minSize);
+            ASSERT_LE(event.quantity, config.maxSize);
+            canceled.push_back(false);
+            break;
+         case OrderFlowEvent::Type::Cancel:
+         case OrderFlowEvent::Type::Modify:
+            // only live passive orders are targeted
+            ASSERT_LT(event.orderId, nAdds);
+            ASSERT_FALSE(canceled[event.orderId]);
+            if (event.type == OrderFlowEvent::Type::Cancel) {
+               canceled[event.orderId] = true;
+               ++nCancels;
+            }
+            break;
+      }
+   }
+
+   ASSERT_NEAR(double(nCancels) / double(events.size()), config.cancelShare, 0.05);
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+
+#include "Journal.h"
+
+TEST(Journal, WriteReadReplay) {
+   auto path = (std::filesystem::temp_directory_path() / "hpds_tests_journal.bin").string();
+
+   std::vector<JournalRecord> written;
+   for (int i = 0; i < 100'000; ++i) {
+      bool isBuy = i % 2 == 0;
+      if (i % 5 == 4) {
+         written.push_back(JournalRecord::Cancel(i / 2));
+      } else if (i % 7 == 6) {
+         written.push_back(JournalRecord::Modify(i / 3, 1));
+      } else {
+         written.push_back(JournalRecord::Add({ 100 + (i * 7) % 11 - (isBuy ? 5 : 0), 1 + i % 4, isBuy }));
+      }
+   }
+
+   {
+      JournalWriter writer{ 64 };
+      ASSERT_TRUE(writer.Open(path.c_str()));
+      for (const auto& record : written) {
+         ASSERT_TRUE(writer.Append(record));
+      }
+      ASSERT_TRUE(writer.Close());
+      ASSERT_FALSE(writer.Failed());
+   }
+
+   JournalReader reader;
+   ASSERT_TRUE(reader.Open(path.c_str()));
+   auto records = reader.Records();
+   ASSERT_EQ(records.size(), written.size());
+   ASSERT_EQ(std::memcmp(records.data(), written.data(), written.size() * sizeof(JournalRecord)), 0);
+
+   OrderBook replayed;
+   ReplayJournal(records, replayed);
+
+   OrderBook expected;
+   for (const auto& record : written) {
+      if (record.type == JournalRecord::Type::Add) {
+         expected.AddOrder(record.price, record.quantity, record.isBuy != 0);
+      } else if (record.type == JournalRecord::Type::Cancel) {
+         expected.CancelOrder(record.orderId);
+      } else {
+         expected.ModifyOrder(record.orderId, record.quantity);
+      }
+   }
+   ASSERT_EQ(replayed.TotalOrders(), expected.TotalOrders());
+   ASSERT_EQ(replayed.BestBid()->quantity, expected.BestBid()->quantity);
+   ASSERT_EQ(replayed.BestAsk()->quantity, expected.BestAsk()->quantity);
+
+   reader.Close();
+   std::filesystem::remove(path);
+   ASSERT_FALSE(reader.Open(path.c_str()));
+}
+
+TEST(Journal, NotOpen) {
+   JournalWriter writer{ 4 };
+   for (int i = 0; i < 8; ++i) {
+      ASSERT_FALSE(writer.Append(JournalRecord::Cancel(i)));
+   }
+   ASSERT_FALSE(writer.Open(""));
+   ASSERT_FALSE(writer.Append(JournalRecord::Cancel(0)));
+
+   // nothing queued before Open ends up in the file
+   auto path = (std::filesystem::temp_directory_path() / "hpds_tests_journal_not_open.bin").string();
+   ASSERT_TRUE(writer.Open(path.c_str()));
+   ASSERT_TRUE(writer.Append(JournalRecord::Cancel(42)));
+   ASSERT_TRUE(writer.Close());
+   ASSERT_FALSE(writer.Append(JournalRecord::Cancel(0)));
+
+   JournalReader reader;
+   ASSERT_TRUE(reader.Open(path.c_str()));
+   ASSERT_EQ(reader.Records().size(), 1);
+   ASSERT_EQ(reader.Records()[0].orderId, 42);
+   reader.Close();
+   std::filesystem::remove(path);
+}
+
+TEST(Journal, WriteError) {
+   if (!std::filesystem::exists("/dev/full")) {
+      GTEST_SKIP() << "needs /dev/full";
+   }
+
+   JournalWriter writer{ 64 };
+   ASSERT_TRUE(writer.Open("/dev/full"));
+
+   // writes to /dev/full fail with ENOSPC once the stdio buffer is flushed
+   bool appended = true;
+   for (int i = 0; i < 100'000 && appended; ++i) {
+      appended = writer.Append(JournalRecord::Cancel(i));
+   }
+   ASSERT_FALSE(writer.Close());
+   ASSERT_TRUE(writer.Failed());
+   ASSERT_FALSE(writer.Append(JournalRecord::Cancel(0)));
+
+   // sticky until the next Open
+   auto path = (std::filesystem::temp_directory_path() / "hpds_tests_journal_error.bin").string();
+   ASSERT_TRUE(writer.Open(path.c_str()));
+   ASSERT_TRUE(writer.Append(JournalRecord::Cancel(0)));
+   ASSERT_TRUE(writer.Close());
+   std::filesystem::remove(path);
+}
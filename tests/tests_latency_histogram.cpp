@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include "LatencyHistogram.h"
+
+TEST(LatencyHistogram, Buckets) {
+   for (uint64_t value : { 0ull, 1ull, 127ull, 128ull, 129ull, 1000ull, 123'456'789ull, ~0ull }) {
+      int index = LatencyHistogram::BucketIndex(value);
+      ASSERT_LT(index, LatencyHistogram::kBuckets);
+      ASSERT_GE(LatencyHistogram::BucketHighestValue(index), value);
+      ASSERT_LE(LatencyHistogram::BucketHighestValue(index) - value, value / 64);
+      if (index > 0) {
+         ASSERT_LT(LatencyHistogram::BucketHighestValue(index - 1), value);
+      }
+   }
+}
+
+TEST(LatencyHistogram, Percentiles) {
+   LatencyHistogram histogram;
+   ASSERT_EQ(histogram.ValueAtPercentile(99), 0);
+
+   for (uint64_t value = 1; value <= 100'000; ++value) {
+      histogram.Record(value);
+   }
+
+   ASSERT_EQ(histogram.Count(), 100'000);
+   ASSERT_EQ(histogram.Max(), 100'000);
+   ASSERT_DOUBLE_EQ(histogram.Mean(), 50'000.5);
+   ASSERT_NEAR((double)histogram.ValueAtPercentile(50), 50'000, 50'000 / 64.0);
+   ASSERT_NEAR((double)histogram.ValueAtPercentile(99), 99'000, 99'000 / 64.0);
+   ASSERT_EQ(histogram.ValueAtPercentile(100), 100'000);
+   ASSERT_EQ(histogram.ValueAtPercentile(0), 1);
+
+   LatencyHistogram other;
+   other.Record(1'000'000);
+   histogram.Merge(other);
+   ASSERT_EQ(histogram.Count(), 100'001);
+   ASSERT_EQ(histogram.ValueAtPercentile(100), 1'000'000);
+
+   histogram.Reset();
+   ASSERT_EQ(histogram.Count(), 0);
+   ASSERT_EQ(histogram.Max(), 0);
+}
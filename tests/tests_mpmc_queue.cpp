@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <thread>
+
+#include "MPMCQueue.h"
+
+TEST(MPMCQueue, SingleThread) {
+   MPMCQueue<int> queue{ 4 };
+   ASSERT_FALSE(queue.TryPop().has_value());
+
+   for (int lap = 0; lap < 3; ++lap) {
+      for (int i = 0; i < 4; ++i) {
+         ASSERT_TRUE(queue.TryPush(lap * 4 + i));
+      }
+      ASSERT_FALSE(queue.TryPush(-1));
+
+      for (int i = 0; i < 4; ++i) {
+         ASSERT_EQ(queue.TryPop(), lap * 4 + i);
+      }
+      ASSERT_FALSE(queue.TryPop().has_value());
+   }
+}
+
+TEST(MPMCQueue, MultiThreaded) {
+   constexpr int nProducers = 3;
+   constexpr int nConsumers = 3;
+   constexpr int count = 30'000;
+   MPMCQueue<int> queue{ 64 };
+
+   std::vector<std::thread> threads;
+   for (int p = 0; p < nProducers; ++p) {
+      threads.emplace_back([&, p] {
+         for (int i = p; i < count; i += nProducers) {
+            queue.Push(i);
+         }
+      });
+   }
+
+   std::vector<std::vector<int>> popped(nConsumers);
+   for (int c = 0; c < nConsumers; ++c) {
+      threads.emplace_back([&, c] {
+         for (int i = 0; i < count / nConsumers; ++i) {
+            popped[c].push_back(queue.PopWait());
+         }
+      });
+   }
+
+   for (auto& thread : threads) {
+      thread.join();
+   }
+
+   // every value exactly once, each consumer sees a producer's values in order
+   std::vector<int> seen(count, 0);
+   for (const auto& values : popped) {
+      std::vector<int> last(nProducers, -1);
+      for (int value : values) {
+         ++seen[value];
+         ASSERT_GT(value, last[value % nProducers]);
+         last[value % nProducers] = value;
+      }
+   }
+   ASSERT_EQ(std::count(seen.begin(), seen.end(), 1), count);
+}
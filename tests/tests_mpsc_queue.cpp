@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+#include "MPSCQueue.h"
+
+TEST(MPSCQueue, Basic) {
+   MPSCQueue<std::string> queue{ 4 };
+   ASSERT_TRUE(queue.Empty());
+   ASSERT_FALSE(queue.Pop().has_value());
+
+   // more than reserved, the pool grows
+   for (int i = 0; i < 3000; ++i) {
+      queue.Push(std::to_string(i));
+   }
+   for (int i = 0; i < 3000; ++i) {
+      ASSERT_EQ(queue.Pop(), std::to_string(i));
+   }
+   ASSERT_TRUE(queue.Empty());
+
+   queue.Push("last");
+   ASSERT_FALSE(queue.Empty());
+   ASSERT_EQ(queue.Pop(), "last");
+   ASSERT_FALSE(queue.Pop().has_value());
+}
+
+TEST(MPSCQueue, MultiThreaded) {
+   constexpr int nProducers = 4;
+   constexpr int count = 100'000;
+   MPSCQueue<int> queue;
+
+   std::vector<std::thread> producers;
+   for (int p = 0; p < nProducers; ++p) {
+      producers.emplace_back([&, p] {
+         for (int i = p; i < count; i += nProducers) {
+            queue.Push(i);
+         }
+      });
+   }
+
+   // values of each producer arrive in order
+   std::vector<int> last(nProducers, -1);
+   bool ok = true;
+   for (int received = 0; received < count;) {
+      if (auto data = queue.Pop()) {
+         ok &= *data > last[*data % nProducers];
+         last[*data % nProducers] = *data;
+         ++received;
+      } else {
+         std::this_thread::yield();
+      }
+   }
+
+   for (auto& producer : producers) {
+      producer.join();
+   }
+   ASSERT_TRUE(ok);
+   ASSERT_TRUE(queue.Empty());
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <set>
+
+#include "OccupancyBitmap.h"
+
+TEST(OccupancyBitmap, NextPrev) {
+   OccupancyBitmap bitmap(300'000);
+   ASSERT_EQ(bitmap.NextSet(0), -1);
+   ASSERT_EQ(bitmap.PrevSet(299'999), -1);
+
+   bitmap.Set(5);
+   bitmap.Set(64);
+   bitmap.Set(250'000);
+   ASSERT_EQ(bitmap.NextSet(0), 5);
+   ASSERT_EQ(bitmap.NextSet(6), 64);
+   ASSERT_EQ(bitmap.NextSet(65), 250'000);
+   ASSERT_EQ(bitmap.NextSet(250'001), -1);
+   ASSERT_EQ(bitmap.PrevSet(299'999), 250'000);
+   ASSERT_EQ(bitmap.PrevSet(249'999), 64);
+   ASSERT_EQ(bitmap.PrevSet(63), 5);
+   ASSERT_EQ(bitmap.PrevSet(4), -1);
+
+   bitmap.Clear(64);
+   ASSERT_FALSE(bitmap.Test(64));
+   ASSERT_EQ(bitmap.NextSet(6), 250'000);
+   ASSERT_EQ(bitmap.PrevSet(249'999), 5);
+}
+
+TEST(OccupancyBitmap, SameAsSet) {
+   constexpr int size = 100'000;
+   OccupancyBitmap bitmap(size);
+   std::set<int> expected;
+
+   uint32_t state = 1;
+   auto rand = [&] { state = state * 1664525 + 1013904223; return int(state >> 8) % size; };
+
+   for (int i = 0; i < 20'000; ++i) {
+      int index = rand();
+      if (i % 3 == 0) {
+         bitmap.Clear(index);
+         expected.erase(index);
+      } else {
+         bitmap.Set(index);
+         expected.insert(index);
+      }
+
+      int from = rand();
+      auto next = expected.lower_bound(from);
+      ASSERT_EQ(bitmap.NextSet(from), next != expected.end() ? *next : -1);
+      auto prev = expected.upper_bound(from);
+      ASSERT_EQ(bitmap.PrevSet(from), prev != expected.begin() ? *std::prev(prev) : -1);
+   }
+}
@@ -1,9 +1,21 @@
 #include <gtest/gtest.h>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <thread>
 
+#include "MatchingEngine.h"
 #include "OrderBook.h"
 
-TEST(OrderBook, Basic) {
-   OrderBook ob;
+template<typename BookType>
+class OrderBookTest : public testing::Test {};
+
+using OrderBookTypesList = testing::Types<OrderBook, LadderOrderBook, MapQueueOrderBook, HashIndexOrderBook, WideOrderBook>;
+TYPED_TEST_SUITE(OrderBookTest, OrderBookTypesList);
+
+TYPED_TEST(OrderBookTest, Basic) {
+   TypeParam ob;
 
    ASSERT_EQ(ob.AddSellOrder(11, 1).id, 0);
    ASSERT_EQ(ob.AddSellOrder(12, 1).id, 1);
@@ -11,15 +23,15 @@ TEST(OrderBook, Basic) {
    ASSERT_EQ(ob.AddBuyOrder(9, 1).id, 2);
    ASSERT_EQ(ob.AddBuyOrder(8, 1).id, 3);
 
-   ASSERT_EQ(ob.AddSellOrder(10, 1).tradeResult, OrderBook::TradeResult{});
-   ASSERT_EQ(ob.AddBuyOrder(10, 1).tradeResult, OrderBook::TradeResult(2, 1));
+   ASSERT_EQ(ob.AddSellOrder(10, 1).tradeResult, typename TypeParam::TradeResult{});
+   ASSERT_EQ(ob.AddBuyOrder(10, 1).tradeResult, typename TypeParam::TradeResult(2, 1));
 
-   ASSERT_EQ(ob.AddSellOrder(10, 2).tradeResult, OrderBook::TradeResult{});
-   ASSERT_EQ(ob.AddBuyOrder(10, 3).tradeResult, OrderBook::TradeResult(1, 2));
+   ASSERT_EQ(ob.AddSellOrder(10, 2).tradeResult, typename TypeParam::TradeResult{});
+   ASSERT_EQ(ob.AddBuyOrder(10, 3).tradeResult, typename TypeParam::TradeResult(1, 2));
 }
 
-TEST(OrderBook, RichBuyer) {
-   OrderBook ob;
+TYPED_TEST(OrderBookTest, RichBuyer) {
+   TypeParam ob;
 
    ob.AddSellOrder(15, 5);
    ob.AddSellOrder(14, 4);
@@ -27,12 +39,12 @@ TEST(OrderBook, RichBuyer) {
    ob.AddSellOrder(12, 2);
    ob.AddSellOrder(11, 1);
 
-   ASSERT_EQ(ob.AddBuyOrder(15, 15).tradeResult, OrderBook::TradeResult( 6, 15 ));
+   ASSERT_EQ(ob.AddBuyOrder(15, 15).tradeResult, typename TypeParam::TradeResult( 6, 15 ));
    ASSERT_EQ(ob.TotalOrders(), 0);
 }
 
-TEST(OrderBook, RichSeller) {
-   OrderBook ob;
+TYPED_TEST(OrderBookTest, RichSeller) {
+   TypeParam ob;
 
    ob.AddBuyOrder(15, 5);
    ob.AddBuyOrder(14, 4);
@@ -40,12 +52,12 @@ TEST(OrderBook, RichSeller) {
    ob.AddBuyOrder(12, 2);
    ob.AddBuyOrder(11, 1);
 
-   ASSERT_EQ(ob.AddSellOrder(0, 15).tradeResult, OrderBook::TradeResult(6, 15));
+   ASSERT_EQ(ob.AddSellOrder(0, 15).tradeResult, typename TypeParam::TradeResult(6, 15));
    ASSERT_EQ(ob.TotalOrders(), 0);
 }
 
-TEST(OrderBook, Buy) {
-   OrderBook ob;
+TYPED_TEST(OrderBookTest, Buy) {
+   TypeParam ob;
 
    ob.AddSellOrder(15, 5);
    ob.AddSellOrder(14, 4);
@@ -53,12 +65,12 @@ TEST(OrderBook, Buy) {
    ob.AddSellOrder(12, 2);
    ob.AddSellOrder(11, 1);
 
-   ASSERT_EQ(ob.AddBuyOrder(15, 4).tradeResult, OrderBook::TradeResult(3, 4));
+   ASSERT_EQ(ob.AddBuyOrder(15, 4).tradeResult, typename TypeParam::TradeResult(3, 4));
    ASSERT_EQ(ob.TotalOrders(), 3);
 }
 
-TEST(OrderBook, Sell) {
-   OrderBook ob;
+TYPED_TEST(OrderBookTest, Sell) {
+   TypeParam ob;
 
    ob.AddBuyOrder(15, 5);
    ob.AddBuyOrder(14, 4);
@@ -66,6 +78,624 @@ TEST(OrderBook, Sell) {
    ob.AddBuyOrder(12, 2);
    ob.AddBuyOrder(11, 1);
 
-   ASSERT_EQ(ob.AddSellOrder(10, 13).tradeResult, OrderBook::TradeResult(4, 13));
+   ASSERT_EQ(ob.AddSellOrder(10, 13).tradeResult, typename TypeParam::TradeResult(4, 13));
+   ASSERT_EQ(ob.TotalOrders(), 2);
+}
+
+TYPED_TEST(OrderBookTest, FarPrices) {
+   TypeParam ob;
+
+   ob.AddSellOrder(1000, 1);
+   ob.AddSellOrder(100'000, 2);
+   ob.AddSellOrder(-5000, 3);
+   ob.AddBuyOrder(-100'000, 4);
+
+   ASSERT_EQ(ob.AddBuyOrder(1000, 5).tradeResult, typename TypeParam::TradeResult(2, 4));
+   ASSERT_EQ(ob.TotalOrders(), 3);
+
+   ASSERT_EQ(ob.AddSellOrder(-200'000, 10).tradeResult, typename TypeParam::TradeResult(2, 5));
+   ASSERT_EQ(ob.AddBuyOrder(200'000, 10).tradeResult, typename TypeParam::TradeResult(2, 7));
+   ASSERT_EQ(ob.TotalOrders(), 1);
+}
+
+// Spans which don't fit a ladder window, far levels move into the window once it gets near them
+TYPED_TEST(OrderBookTest, VeryFarPrices) {
+   TypeParam ob;
+   using LevelInfo = typename TypeParam::LevelInfo;
+   std::array<LevelInfo, 4> depth{};
+
+   auto sellFar = ob.AddSellOrder(1'500'000'000, 2).id;
+   ob.AddSellOrder(0, 1);
+   auto sellFar1 = ob.AddSellOrder(1'500'000'001, 3).id;
+   ob.AddBuyOrder(-1'500'000'000, 4);
+
+   ASSERT_EQ(ob.BestAsk()->price, 0);
+   ASSERT_EQ(ob.BestBid()->price, -1'500'000'000);
+   ASSERT_EQ(ob.GetDepth(false, depth), 3);
+   ASSERT_EQ(depth[0].price, 0);
+   ASSERT_EQ(depth[1].price, 1'500'000'000);
+   ASSERT_EQ(depth[2].price, 1'500'000'001);
+   ASSERT_EQ(depth[2].quantity, 3);
+
+   ASSERT_EQ(ob.AddBuyOrder(1'500'000'000, 2).tradeResult, typename TypeParam::TradeResult(2, 2));
+   ASSERT_EQ(ob.BestAsk()->price, 1'500'000'000);
+   ASSERT_EQ(ob.BestAsk()->quantity, 1);
+
+   ASSERT_TRUE(ob.CancelOrder(sellFar));
+   ob.AddSellOrder(-1'000'000'000, 1);
+   ob.AddSellOrder(-999'999'995, 2);
+   ASSERT_EQ(ob.BestAsk()->price, -1'000'000'000);
+   ASSERT_TRUE(ob.CancelOrder(sellFar1));
+
+   ob.AddSellOrder(-1'000'000'002, 3);
+   ASSERT_EQ(ob.GetDepth(false, depth), 3);
+   ASSERT_EQ(depth[0].price, -1'000'000'002);
+   ASSERT_EQ(depth[1].price, -1'000'000'000);
+   ASSERT_EQ(depth[2].price, -999'999'995);
+   ASSERT_EQ(depth[2].quantity, 2);
+   ASSERT_EQ(ob.TotalOrders(), 4);
+
+   ASSERT_EQ(ob.AddSellOrder(-2'000'000'000, 10).tradeResult, typename TypeParam::TradeResult(1, 4));
+   ASSERT_EQ(ob.BestAsk()->price, -2'000'000'000);
+   ASSERT_EQ(ob.BestAsk()->quantity, 6);
+   ASSERT_FALSE(ob.BestBid().has_value());
+}
+
+// More resting orders than reserved, slab grows
+TYPED_TEST(OrderBookTest, PastReserved) {
+   TypeParam ob{ 4 };
+
+   for (int i = 0; i < 6; ++i) {
+      ASSERT_EQ(ob.AddSellOrder(10 + i, 1).id, i);
+   }
+   ASSERT_EQ(ob.TotalOrders(), 6);
+   ASSERT_TRUE(ob.CancelOrder(5));
+   ASSERT_TRUE(ob.ModifyOrder(4, 0));
+
+   std::vector<uint8_t> snapshot;
+   ob.SaveSnapshot(snapshot);
+   TypeParam restored{ 1 };
+   ASSERT_TRUE(restored.LoadSnapshot(snapshot));
+   ASSERT_EQ(restored.TotalOrders(), 4);
+
+   ASSERT_EQ(ob.AddBuyOrder(20, 10).tradeResult, typename TypeParam::TradeResult(4, 4));
+   ASSERT_EQ(restored.AddBuyOrder(20, 10).tradeResult, typename TypeParam::TradeResult(4, 4));
+   ASSERT_EQ(ob.TotalOrders(), 1);
+   ASSERT_EQ(ob.BestBid()->quantity, 6);
+}
+
+TYPED_TEST(OrderBookTest, Cancel) {
+   TypeParam ob;
+
+   auto sell0 = ob.AddSellOrder(10, 1).id;
+   auto sell1 = ob.AddSellOrder(10, 2).id;
+   auto sell2 = ob.AddSellOrder(11, 3).id;
+
+   ASSERT_TRUE(ob.CancelOrder(sell0));
+   ASSERT_FALSE(ob.CancelOrder(sell0));
+   ASSERT_FALSE(ob.CancelOrder(100));
+   ASSERT_EQ(ob.TotalOrders(), 2);
+
+   ASSERT_EQ(ob.AddBuyOrder(10, 5).tradeResult, typename TypeParam::TradeResult(1, 2));
+   ASSERT_FALSE(ob.CancelOrder(sell1));
+
+   ASSERT_TRUE(ob.CancelOrder(sell2));
+   ASSERT_EQ(ob.AddBuyOrder(11, 1).tradeResult, typename TypeParam::TradeResult{});
    ASSERT_EQ(ob.TotalOrders(), 2);
 }
+
+TYPED_TEST(OrderBookTest, Modify) {
+   TypeParam ob;
+
+   auto sell0 = ob.AddSellOrder(10, 5).id;
+   auto sell1 = ob.AddSellOrder(10, 5).id;
+
+   ASSERT_FALSE(ob.ModifyOrder(sell0, 6));
+   ASSERT_TRUE(ob.ModifyOrder(sell0, 2));
+   ASSERT_TRUE(ob.ModifyOrder(sell1, 0));
+   ASSERT_FALSE(ob.ModifyOrder(sell1, 1));
+
+   ASSERT_EQ(ob.AddBuyOrder(10, 5).tradeResult, typename TypeParam::TradeResult(1, 2));
+   ASSERT_EQ(ob.TotalOrders(), 1);
+}
+
+TYPED_TEST(OrderBookTest, TimePriority) {
+   TypeParam ob;
+
+   auto sell0 = ob.AddSellOrder(10, 1).id;
+   auto sell1 = ob.AddSellOrder(10, 2).id;
+   auto sell2 = ob.AddSellOrder(10, 3).id;
+   auto sell3 = ob.AddSellOrder(10, 4).id;
+
+   ASSERT_TRUE(ob.CancelOrder(sell1));
+   ASSERT_TRUE(ob.CancelOrder(sell3));
+
+   // fills sell0 and part of sell2
+   ASSERT_EQ(ob.AddBuyOrder(10, 2).tradeResult, typename TypeParam::TradeResult(2, 2));
+   ASSERT_FALSE(ob.CancelOrder(sell0));
+   ASSERT_TRUE(ob.ModifyOrder(sell2, 1));
+
+   auto sell4 = ob.AddSellOrder(10, 5).id;
+   ASSERT_EQ(ob.AddBuyOrder(10, 3).tradeResult, typename TypeParam::TradeResult(2, 3));
+   ASSERT_FALSE(ob.CancelOrder(sell2));
+   ASSERT_TRUE(ob.ModifyOrder(sell4, 3));
+   ASSERT_EQ(ob.TotalOrders(), 1);
+}
+
+TYPED_TEST(OrderBookTest, Batch) {
+   using LevelInfo = typename TypeParam::LevelInfo;
+   using LevelUpdate = typename TypeParam::LevelUpdate;
+
+   TypeParam single;
+   TypeParam batched;
+   single.TrackLevelChanges(true);
+   batched.TrackLevelChanges(true);
+
+   // runs of passive orders on one level broken by crossing and non limit orders
+   std::vector<typename TypeParam::OrderRequest> requests;
+   for (int i = 0; i < 1000; ++i) {
+      bool isBuy = i % 3 != 0;
+      OrderType type = i % 17 == 0 ? OrderType::Market : i % 23 == 0 ? OrderType::FillOrKill
+         : i % 29 == 0 ? OrderType::ImmediateOrCancel : OrderType::Limit;
+      requests.push_back({ 100 + (i / 4 * 7) % 13 - (isBuy ? 6 : 0), 1 + i % 5, isBuy, type });
+   }
+
+   std::vector<typename TypeParam::OrderResult> expected;
+   for (const auto& request : requests) {
+      expected.push_back(single.AddOrder(request));
+   }
+
+   std::vector<typename TypeParam::OrderResult> results(requests.size());
+   for (size_t i = 0; i < requests.size(); i += 64) {
+      size_t count = std::min<size_t>(64, requests.size() - i);
+      batched.AddOrders(std::span(requests).subspan(i, count), std::span(results).subspan(i, count));
+   }
+
+   ASSERT_EQ(results, expected);
+   ASSERT_EQ(batched.TotalOrders(), single.TotalOrders());
+
+   for (bool isBuy : { true, false }) {
+      std::array<LevelInfo, 32> singleDepth{};
+      std::array<LevelInfo, 32> batchedDepth{};
+      int depth = single.GetDepth(isBuy, singleDepth);
+      ASSERT_EQ(batched.GetDepth(isBuy, batchedDepth), depth);
+      for (int i = 0; i < depth; ++i) {
+         ASSERT_EQ(batchedDepth[i].price, singleDepth[i].price);
+         ASSERT_EQ(batchedDepth[i].quantity, singleDepth[i].quantity);
+      }
+   }
+
+   std::array<LevelUpdate, 64> singleUpdates{};
+   std::array<LevelUpdate, 64> batchedUpdates{};
+   ASSERT_EQ(batched.ConsumeLevelChanges(batchedUpdates), single.ConsumeLevelChanges(singleUpdates));
+   ASSERT_EQ(batchedUpdates, singleUpdates);
+}
+
+TYPED_TEST(OrderBookTest, Fills) {
+   TypeParam ob;
+   using Fill = typename TypeParam::Fill;
+
+   std::vector<Fill> fills;
+   auto onFill = [&](const Fill& fill) { fills.push_back(fill); };
+
+   auto sell0 = ob.AddSellOrder(11, 2).id;
+   auto sell1 = ob.AddSellOrder(10, 1).id;
+   auto sell2 = ob.AddSellOrder(11, 2).id;
+
+   auto buy0 = ob.AddOrder(11, 4, true, onFill).id;
+   ASSERT_EQ(fills, (std::vector<Fill>{ { sell1, buy0, 10, 1 }, { sell0, buy0, 11, 2 }, { sell2, buy0, 11, 1 } }));
+
+   fills.clear();
+   auto buy1 = ob.AddBuyOrder(9, 3).id;
+   auto sell3 = ob.AddOrder(8, 5, false, onFill).id;
+   ASSERT_EQ(fills, (std::vector<Fill>{ { buy1, sell3, 9, 3 } }));
+}
+
+TYPED_TEST(OrderBookTest, Depth) {
+   TypeParam ob;
+   using LevelInfo = typename TypeParam::LevelInfo;
+
+   ASSERT_FALSE(ob.BestBid().has_value());
+   ASSERT_FALSE(ob.BestAsk().has_value());
+
+   ob.AddSellOrder(12, 1);
+   ob.AddSellOrder(11, 2);
+   ob.AddSellOrder(11, 3);
+   ob.AddBuyOrder(9, 4);
+   ob.AddBuyOrder(7, 5);
+
+   ASSERT_EQ(ob.BestAsk()->price, 11);
+   ASSERT_EQ(ob.BestAsk()->quantity, 5);
+   ASSERT_EQ(ob.BestBid()->price, 9);
+
+   std::array<LevelInfo, 4> depth{};
+   ASSERT_EQ(ob.GetDepth(false, depth), 2);
+   ASSERT_EQ(depth[0].price, 11);
+   ASSERT_EQ(depth[1].price, 12);
+   ASSERT_EQ(depth[1].quantity, 1);
+
+   ASSERT_EQ(ob.GetDepth(true, std::span(depth).first(1)), 1);
+   ASSERT_EQ(depth[0].price, 9);
+   ASSERT_EQ(depth[0].quantity, 4);
+}
+
+TYPED_TEST(OrderBookTest, LevelChanges) {
+   TypeParam ob;
+   using LevelUpdate = typename TypeParam::LevelUpdate;
+
+   std::array<LevelUpdate, 8> updates{};
+   ob.AddSellOrder(12, 1);
+   ASSERT_EQ(ob.ConsumeLevelChanges(updates), 0);
+
+   ob.TrackLevelChanges(true);
+   auto sell = ob.AddSellOrder(11, 2).id;
+   ob.AddSellOrder(11, 3);
+   ob.AddBuyOrder(9, 4);
+
+   ASSERT_EQ(ob.ConsumeLevelChanges(std::span(updates).first(1)), 1);
+   ASSERT_EQ(updates[0], LevelUpdate(11, 5, false));
+   ASSERT_EQ(ob.ConsumeLevelChanges(updates), 1);
+   ASSERT_EQ(updates[0], LevelUpdate(9, 4, true));
+   ASSERT_EQ(ob.ConsumeLevelChanges(updates), 0);
+
+   // sweeps asks, sell level 12 drained and created again, reported once. Filled buy never rests.
+   ob.AddBuyOrder(12, 6);
+   ob.AddSellOrder(12, 7);
+   ASSERT_FALSE(ob.CancelOrder(sell));
+   ASSERT_EQ(ob.ConsumeLevelChanges(updates), 2);
+   ASSERT_EQ(updates[0], LevelUpdate(11, 0, false));
+   ASSERT_EQ(updates[1], LevelUpdate(12, 7, false));
+}
+
+TYPED_TEST(OrderBookTest, ImmediateOrCancel) {
+   TypeParam ob;
+
+   ob.AddSellOrder(10, 1);
+   ob.AddSellOrder(11, 2);
+   ob.AddSellOrder(12, 3);
+
+   ASSERT_EQ(ob.AddOrder({ 11, 5, true, OrderType::ImmediateOrCancel }).tradeResult, typename TypeParam::TradeResult(2, 3));
+   ASSERT_EQ(ob.TotalOrders(), 1);
+   ASSERT_EQ(ob.BestAsk()->price, 12);
+   ASSERT_FALSE(ob.BestBid().has_value());
+
+   ASSERT_EQ(ob.AddOrder({ 11, 5, true, OrderType::ImmediateOrCancel }).tradeResult, typename TypeParam::TradeResult{});
+   ASSERT_EQ(ob.TotalOrders(), 1);
+}
+
+TYPED_TEST(OrderBookTest, FillOrKill) {
+   TypeParam ob;
+
+   ob.AddBuyOrder(12, 1);
+   ob.AddBuyOrder(11, 2);
+   ob.AddBuyOrder(10, 3);
+
+   ASSERT_EQ(ob.AddOrder({ 11, 4, false, OrderType::FillOrKill }).tradeResult, typename TypeParam::TradeResult{});
+   ASSERT_EQ(ob.TotalOrders(), 3);
+
+   ASSERT_EQ(ob.AddOrder({ 10, 4, false, OrderType::FillOrKill }).tradeResult, typename TypeParam::TradeResult(3, 4));
+   ASSERT_EQ(ob.TotalOrders(), 1);
+   ASSERT_EQ(ob.BestBid()->quantity, 2);
+}
+
+TYPED_TEST(OrderBookTest, Market) {
+   TypeParam ob;
+
+   ob.AddSellOrder(10, 1);
+   ob.AddSellOrder(1000, 2);
+
+   auto buy = ob.AddOrder({ 0, 5, true, OrderType::Market });
+   ASSERT_EQ(buy.tradeResult, typename TypeParam::TradeResult(2, 3));
+   ASSERT_FALSE(ob.CancelOrder(buy.id));
+   ASSERT_EQ(ob.TotalOrders(), 0);
+
+   ASSERT_EQ(ob.AddOrder({ 0, 5, false, OrderType::Market }).tradeResult, typename TypeParam::TradeResult{});
+   ASSERT_EQ(ob.TotalOrders(), 0);
+   ASSERT_EQ(ob.AddSellOrder(10, 1).id, buy.id + 2);
+}
+
+TYPED_TEST(OrderBookTest, Snapshot) {
+   TypeParam ob;
+
+   for (int i = 0; i < 1000; ++i) {
+      bool isBuy = i % 3 != 0;
+      ob.AddOrder(100 + (i * 7) % 13 - (isBuy ? 6 : 0), 1 + i % 5, isBuy);
+      if (i % 4 == 0) {
+         ob.CancelOrder(i / 2);
+      }
+   }
+
+   std::vector<uint8_t> snapshot;
+   ob.SaveSnapshot(snapshot);
+
+   TypeParam restored;
+   restored.AddSellOrder(1, 1);
+   ASSERT_TRUE(restored.LoadSnapshot(snapshot));
+   ASSERT_EQ(restored.TotalOrders(), ob.TotalOrders());
+
+   std::vector<uint8_t> snapshotOfRestored;
+   restored.SaveSnapshot(snapshotOfRestored);
+   ASSERT_EQ(snapshotOfRestored, snapshot);
+
+   // same ids, same queue order
+   for (int i = 0; i < 1000; ++i) {
+      bool isBuy = i % 2 != 0;
+      auto price = 100 + (i * 5) % 17 - 8;
+      ASSERT_EQ(restored.AddOrder(price, 1 + i % 7, isBuy), ob.AddOrder(price, 1 + i % 7, isBuy));
+      ASSERT_EQ(restored.CancelOrder(i * 3), ob.CancelOrder(i * 3));
+   }
+
+   int total = restored.TotalOrders();
+   snapshot.pop_back();
+   ASSERT_FALSE(restored.LoadSnapshot(snapshot));
+   ASSERT_EQ(restored.TotalOrders(), total);
+   ASSERT_FALSE(restored.LoadSnapshot({}));
+   ASSERT_EQ(restored.TotalOrders(), total);
+}
+
+// Mirrors the snapshot layout of BasicOrderBook to corrupt single records
+template<typename Book>
+struct SnapshotLayout {
+   struct Header {
+      uint64_t magic;
+      uint32_t version;
+      int32_t nOrders;
+      typename Book::OrderId nextOrderId;
+      int32_t nLevels[2];
+      int32_t reserved;
+   };
+
+   struct Level {
+      typename Book::Price price;
+      int32_t nOrders;
+   };
+
+   struct Order {
+      typename Book::OrderId id;
+      typename Book::Quantity quantity;
+   };
+
+   template<typename Record, typename F>
+   static void Modify(std::vector<uint8_t>& data, size_t offset, F&& modify) {
+      Record record;
+      std::memcpy(&record, data.data() + offset, sizeof(record));
+      modify(record);
+      std::memcpy(data.data() + offset, &record, sizeof(record));
+   }
+};
+
+TYPED_TEST(OrderBookTest, SnapshotMalformed) {
+   using Layout = SnapshotLayout<TypeParam>;
+   using Level = typename Layout::Level;
+   using Order = typename Layout::Order;
+
+   // levels: buy 9, sell 11, sell 12. orders: 3 | 0, 1 | 2
+   TypeParam ob;
+   ob.AddSellOrder(11, 1);
+   ob.AddSellOrder(11, 2);
+   ob.AddSellOrder(12, 3);
+   ob.AddBuyOrder(9, 4);
+
+   std::vector<uint8_t> snapshot;
+   ob.SaveSnapshot(snapshot);
+   ASSERT_EQ(snapshot.size(), sizeof(typename Layout::Header) + 3 * sizeof(Level) + 4 * sizeof(Order));
+
+   TypeParam restored;
+   restored.AddSellOrder(20, 5);
+
+   auto loads = [&](auto&& corrupt) {
+      auto data = snapshot;
+      corrupt(data);
+      return restored.LoadSnapshot(data);
+   };
+   auto level = [](std::vector<uint8_t>& data, int i, auto&& modify) {
+      Layout::template Modify<Level>(data, sizeof(typename Layout::Header) + i * sizeof(Level), modify);
+   };
+   auto order = [](std::vector<uint8_t>& data, int i, auto&& modify) {
+      Layout::template Modify<Order>(data, sizeof(typename Layout::Header) + 3 * sizeof(Level) + i * sizeof(Order), modify);
+   };
+
+   ASSERT_FALSE(loads([&](auto& data) { order(data, 2, [](Order& o) { o.id = 0; }); }));        // duplicate id
+   ASSERT_FALSE(loads([&](auto& data) { order(data, 0, [](Order& o) { o.id = 4; }); }));        // not issued yet
+   ASSERT_FALSE(loads([&](auto& data) { order(data, 0, [](Order& o) { o.quantity = 0; }); }));
+   ASSERT_FALSE(loads([&](auto& data) { order(data, 3, [](Order& o) { o.quantity = -1; }); }));
+   ASSERT_FALSE(loads([&](auto& data) { level(data, 2, [](Level& l) { l.price = 11; }); }));    // duplicate level
+   ASSERT_FALSE(loads([&](auto& data) { level(data, 2, [](Level& l) { l.price = 10; }); }));    // sell levels out of order
+   ASSERT_FALSE(loads([&](auto& data) { level(data, 0, [](Level& l) { l.price = 11; }); }));    // crossed
+   ASSERT_FALSE(loads([&](auto& data) { level(data, 1, [](Level& l) { l.nOrders = 3; }); }));
+   ASSERT_FALSE(loads([&](auto& data) {                                                         // fewer ids than orders
+      Layout::template Modify<typename Layout::Header>(data, 0, [](auto& h) { h.nextOrderId = 3; });
+   }));
+   if constexpr (sizeof(typename TypeParam::OrderId) == 8) {
+      // id index can't hold ids that far
+      ASSERT_FALSE(loads([&](auto& data) {
+         Layout::template Modify<typename Layout::Header>(data, 0, [](auto& h) { h.nextOrderId = std::numeric_limits<int64_t>::max() - 1; });
+      }));
+   }
+
+   // left unchanged
+   ASSERT_EQ(restored.TotalOrders(), 1);
+   ASSERT_EQ(restored.BestAsk()->price, 20);
+
+   ASSERT_TRUE(loads([](auto&) {}));
+   ASSERT_EQ(restored.TotalOrders(), 4);
+   ASSERT_EQ(restored.BestAsk()->price, 11);
+   ASSERT_EQ(restored.BestBid()->price, 9);
+}
+
+TEST(WideOrderBook, PricesAboveIntMax) {
+   using Fill = WideOrderBook::Fill;
+   constexpr int64_t kFar = 1'000'000'000'000'000;
+
+   WideOrderBook ob;
+   ob.AddBuyOrder(0, 1);
+   ob.AddSellOrder(5'000'000'000, 2);
+   ob.AddSellOrder(5'000'000'001, 3);
+   ob.AddSellOrder(kFar, 4);
+
+   ASSERT_EQ(ob.BestBid()->price, 0);
+   ASSERT_EQ(ob.BestAsk()->price, 5'000'000'000);
+   std::array<WideOrderBook::LevelInfo, 4> depth{};
+   ASSERT_EQ(ob.GetDepth(false, depth), 3);
+   ASSERT_EQ(depth[1].price, 5'000'000'001);
+   ASSERT_EQ(depth[2].price, kFar);
+
+   std::vector<Fill> fills;
+   auto onFill = [&](const Fill& fill) { fills.push_back(fill); };
+   auto buy = ob.AddOrder(5'000'000'001, 4, true, onFill);
+   ASSERT_EQ(buy.tradeResult, WideOrderBook::TradeResult(2, 4));
+   ASSERT_EQ(fills, (std::vector<Fill>{ { 1, buy.id, 5'000'000'000, 2 }, { 2, buy.id, 5'000'000'001, 2 } }));
+
+   std::vector<uint8_t> snapshot;
+   ob.SaveSnapshot(snapshot);
+   WideOrderBook restored;
+   ASSERT_TRUE(restored.LoadSnapshot(snapshot));
+   std::vector<uint8_t> snapshotOfRestored;
+   restored.SaveSnapshot(snapshotOfRestored);
+   ASSERT_EQ(snapshotOfRestored, snapshot);
+
+   auto market = restored.AddOrder(WideOrderBook::OrderRequest{ 0, 10, true, OrderType::Market });
+   ASSERT_EQ(market.tradeResult, WideOrderBook::TradeResult(2, 5));
+   ASSERT_FALSE(restored.BestAsk().has_value());
+   ASSERT_EQ(restored.BestBid()->price, 0);
+}
+
+// 64 bit books on ladder and tree levels, resting and matching at the ends of the int64 range
+struct WideMapOrderBookPolicy : DefaultOrderBookPolicy {
+   using OrderId = int64_t;
+   using Price = int64_t;
+};
+
+template<typename BookType>
+class WideOrderBookTest : public testing::Test {};
+
+using WideOrderBookTypesList = testing::Types<WideOrderBook, BasicOrderBook<WideMapOrderBookPolicy>>;
+TYPED_TEST_SUITE(WideOrderBookTest, WideOrderBookTypesList);
+
+TYPED_TEST(WideOrderBookTest, PriceLimits) {
+   using TradeResult = typename TypeParam::TradeResult;
+   constexpr int64_t kMin = std::numeric_limits<int64_t>::lowest();
+   constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+
+   for (bool isBuy : { true, false }) {
+      TypeParam ob;
+      std::array<typename TypeParam::LevelInfo, 4> depth{};
+
+      auto minId = ob.AddOrder(kMin + 1, 1, isBuy).id;
+      ob.AddOrder(kMax, 2, isBuy);
+      ob.AddOrder(kMax - 1, 3, isBuy);
+      ASSERT_EQ(ob.TotalOrders(), 3);
+
+      ASSERT_EQ(ob.GetDepth(isBuy, depth), 3);
+      if (isBuy) {
+         ASSERT_EQ(depth[0].price, kMax);
+         ASSERT_EQ(depth[1].price, kMax - 1);
+         ASSERT_EQ(depth[2].price, kMin + 1);
+      } else {
+         ASSERT_EQ(depth[0].price, kMin + 1);
+         ASSERT_EQ(depth[1].price, kMax - 1);
+         ASSERT_EQ(depth[2].price, kMax);
+      }
+
+      std::vector<uint8_t> snapshot;
+      ob.SaveSnapshot(snapshot);
+      TypeParam restored;
+      ASSERT_TRUE(restored.LoadSnapshot(snapshot));
+      ASSERT_EQ(restored.TotalOrders(), 3);
+
+      // sweeps every level
+      ASSERT_EQ(restored.AddOrder(isBuy ? kMin : kMax, 10, !isBuy).tradeResult, TradeResult(3, 6));
+      ASSERT_FALSE((isBuy ? restored.BestBid() : restored.BestAsk()).has_value());
+
+      ASSERT_TRUE(ob.CancelOrder(minId));
+      ASSERT_EQ(ob.AddOrder(kMax - 1, 4, !isBuy).tradeResult, isBuy ? TradeResult(2, 4) : TradeResult(1, 3));
+      ASSERT_EQ((isBuy ? ob.BestBid() : ob.BestAsk())->price, isBuy ? kMax - 1 : kMax);
+      ASSERT_EQ(ob.TotalOrders(), isBuy ? 1 : 2);
+   }
+}
+
+// Long session with few resting orders and one old order which is never filled
+TEST(DenseIdIndex, Bounded) {
+   DenseIdIndex<int> index;
+   constexpr int lag = 10;
+
+   index.Insert(0, 0);
+   for (int id = 1; id < 1'000'000; ++id) {
+      index.Insert(id, id % 100);
+      if (id > lag) {
+         index.Erase(id - lag);
+      }
+   }
+
+   // the page of the old order and the current one
+   ASSERT_LE(index.PagesInUse(), 3);
+   ASSERT_EQ(index.Find(0), 0);
+   ASSERT_EQ(index.Find(999'999), 99);
+   ASSERT_EQ(index.Find(999'999 - lag), -1);
+   ASSERT_EQ(index.Find(1'000'000), -1);
+
+   index.Erase(0);
+   ASSERT_EQ(index.Find(0), -1);
+}
+
+TEST(MatchingEngine, SameAsSingleBooks) {
+   constexpr int nSymbols = 7;
+   constexpr int count = 20'000;
+
+   // per symbol slab hints, books grow past them
+   std::vector<int> reservedOrders(nSymbols, 16);
+   reservedOrders[0] = 1024;
+   MatchingEngine<OrderBook> engine{ 3, reservedOrders, 64 };
+   std::vector<OrderBook> books(nSymbols);
+   std::vector<std::vector<OrderBook::OrderResult>> expected(nSymbols);
+   std::vector<std::vector<OrderBook::OrderResult>> results(nSymbols);
+
+   auto onResult = [&](const MatchingEngine<OrderBook>::EngineResult& result) {
+      results[result.symbol].push_back(result.result);
+   };
+
+   engine.Start();
+   for (int i = 0; i < count; ++i) {
+      int symbol = (i * 31) % nSymbols;
+      bool isBuy = i % 2 == 0;
+      OrderBook::OrderRequest request{ 100 + (i * 7) % 11 - (isBuy ? 5 : 0), 1 + i % 4, isBuy };
+
+      expected[symbol].push_back(books[symbol].AddOrder(request.price, request.quantity, request.isBuy));
+      while (!engine.Submit(symbol, request)) {
+         engine.PollResults(onResult);
+      }
+   }
+
+   int received = 0;
+   for (const auto& symbolResults : results) {
+      received += (int)symbolResults.size();
+   }
+   while (received < count) {
+      received += engine.PollResults(onResult);
+   }
+   engine.Stop();
+
+   ASSERT_EQ(results, expected);
+}
+
+TEST(MatchingEngine, WakesParkedWorkers) {
+   constexpr int nSymbols = 4;
+   MatchingEngine<OrderBook, ParkWait> engine{ 2, nSymbols, 16, 16 };
+
+   for (int run = 0; run < 2; ++run) {
+      engine.Start();
+      // idle long enough for workers to park, submit and Stop have to wake them
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+      for (int symbol = 0; symbol < nSymbols; ++symbol) {
+         ASSERT_TRUE(engine.Submit(symbol, { 100, 1, true }));
+      }
+
+      int received = 0;
+      while (received < nSymbols) {
+         received += engine.PollResults([](const auto& result) { ASSERT_EQ(result.result.tradeResult.volume, 0); });
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      engine.Stop();
+   }
+}
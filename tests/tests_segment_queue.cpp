@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include <string>
+
+#include "Helpers.h"
+#include "SegmentQueue.h"
+
+TEST(SegmentQueue, Basic) {
+   SegmentQueue<int, 64> queue;
+   ASSERT_TRUE(queue.Empty());
+   ASSERT_FALSE(queue.Dequeue().has_value());
+
+   int n = (int)queue.SegmentCapacity() * 3 + 5;
+   for (int i = 0; i < n; ++i) {
+      queue.Enqueue(i);
+   }
+   ASSERT_EQ(queue.Size(), n);
+   ASSERT_EQ(queue.Front(), 0);
+
+   int expected = 0;
+   queue.ForEach([&](int value) { ASSERT_EQ(value, expected++); });
+   ASSERT_EQ(expected, n);
+
+   for (int i = 0; i < n; ++i) {
+      ASSERT_EQ(queue.Dequeue(), i);
+   }
+   ASSERT_TRUE(queue.Empty());
+   ASSERT_FALSE(queue.Dequeue().has_value());
+}
+
+TEST(SegmentQueue, Bulk) {
+   SegmentQueue<int, 64> queue;
+   std::vector<int> in(100);
+   for (int i = 0; i < 100; ++i) {
+      in[i] = i;
+   }
+
+   ASSERT_EQ(queue.EnqueueN(std::span{ in.data(), 37 }), 37);
+   std::vector<int> out(100);
+   ASSERT_EQ(queue.DequeueN(std::span{ out.data(), 20 }), 20);
+   ASSERT_EQ(queue.EnqueueN(std::span{ in.data() + 37, 63 }), 63);
+   ASSERT_EQ(queue.DequeueN(std::span{ out.data() + 20, 80 }), 80);
+   ASSERT_EQ(out, in);
+   ASSERT_EQ(queue.DequeueN(out), 0);
+}
+
+TEST(SegmentQueue, SameAsDeque) {
+   SegmentQueue<std::string, 128> queue;
+   std::deque<std::string> reference;
+
+   for (int i = 0; i < 100'000; ++i) {
+      if (RandUint(0, 2) != 0) {
+         queue.Enqueue(std::to_string(i));
+         reference.push_back(std::to_string(i));
+      } else {
+         auto value = queue.Dequeue();
+         ASSERT_EQ(value.has_value(), !reference.empty());
+         if (value) {
+            ASSERT_EQ(*value, reference.front());
+            reference.pop_front();
+         }
+      }
+      ASSERT_EQ(queue.Size(), reference.size());
+   }
+
+   queue.Clear();
+   ASSERT_TRUE(queue.Empty());
+   queue.ShrinkToFit();
+}
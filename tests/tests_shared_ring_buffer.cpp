@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "SharedRingBuffer.h"
+
+#ifndef _WIN32
+
+TEST(SharedRingBuffer, CreateAttach) {
+   const char* name = "/hpds_tests_shared_ring";
+   SharedRingBuffer<int> consumer;
+   SharedRingBuffer<int> producer;
+   ASSERT_FALSE(producer.Attach(name));
+
+   ASSERT_TRUE(consumer.Create(name, 3));
+   ASSERT_TRUE(producer.Attach(name));
+   ASSERT_EQ(producer.Capacity(), 3);
+
+   // different payload layout is refused
+   SharedRingBuffer<int64_t> wide;
+   ASSERT_FALSE(wide.Attach(name));
+
+   for (int round = 0; round < 3; ++round) {
+      ASSERT_TRUE(producer.Push(round));
+      ASSERT_TRUE(producer.Push(round + 1));
+      ASSERT_FALSE(producer.Push(round + 2));
+      ASSERT_TRUE(consumer.WasFull());
+
+      ASSERT_EQ(consumer.Pop(), round);
+      ASSERT_EQ(consumer.Pop(), round + 1);
+      ASSERT_FALSE(consumer.Pop().has_value());
+   }
+
+   // creator removes the name, the mapping stays valid
+   consumer.Close();
+   ASSERT_TRUE(producer.Push(42));
+   SharedRingBuffer<int> late;
+   ASSERT_FALSE(late.Attach(name));
+}
+
+TEST(SharedMemory, CreateExisting) {
+   const char* name = "/hpds_tests_shared_memory";
+   SharedMemory::Remove(name);
+
+   SharedMemory first;
+   ASSERT_TRUE(first.Create(name, 4096));
+   static_cast<int*>(first.Data())[0] = 42;
+
+   // live segment is not taken over
+   SharedMemory second;
+   ASSERT_FALSE(second.Create(name, 4096));
+   ASSERT_TRUE(second.Attach(name));
+   ASSERT_EQ(static_cast<int*>(second.Data())[0], 42);
+   second.Close();
+
+   // explicit cleanup, e.g. after a crashed creator. Existing mapping stays valid
+   ASSERT_TRUE(SharedMemory::Remove(name));
+   ASSERT_FALSE(SharedMemory::Remove(name));
+   ASSERT_TRUE(second.Create(name, 4096));
+   ASSERT_EQ(static_cast<int*>(second.Data())[0], 0);
+   ASSERT_EQ(static_cast<int*>(first.Data())[0], 42);
+
+   // old creator doesn't remove the new segment's name
+   first.Close();
+   SharedMemory third;
+   ASSERT_TRUE(third.Attach(name));
+   third.Close();
+   second.Close();
+   ASSERT_FALSE(third.Attach(name));
+}
+
+TEST(SharedRingBuffer, MultiProcess) {
+   ASSERT_TRUE(SharedRingBufferMultiProcessTest("/hpds_tests_shared_ring_mp", 1024, 100'000));
+}
+
+#endif
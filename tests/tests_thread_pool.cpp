@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <thread>
+
+#include "ThreadPool.h"
+#include "WorkStealingDeque.h"
+
+TEST(WorkStealingDeque, SingleThread) {
+   WorkStealingDeque<int> deque{ 2 };
+   ASSERT_FALSE(deque.Pop().has_value());
+   ASSERT_FALSE(deque.Steal().has_value());
+
+   // grows past the initial capacity
+   for (int i = 0; i < 10; ++i) {
+      deque.Push(i);
+   }
+   ASSERT_EQ(deque.Size(), 10);
+
+   // owner is LIFO, thieves FIFO
+   ASSERT_EQ(deque.Pop(), 9);
+   ASSERT_EQ(deque.Steal(), 0);
+   ASSERT_EQ(deque.Steal(), 1);
+   ASSERT_EQ(deque.Pop(), 8);
+
+   for (int i = 7; i >= 2; --i) {
+      ASSERT_EQ(deque.Pop(), i);
+   }
+   ASSERT_FALSE(deque.Pop().has_value());
+   ASSERT_FALSE(deque.Steal().has_value());
+}
+
+TEST(WorkStealingDeque, MultiThreaded) {
+   constexpr int count = 200'000;
+   constexpr int nThieves = 3;
+   WorkStealingDeque<int> deque{ 16 };
+   std::vector<std::atomic<int>> taken(count);
+   std::atomic<int> nTaken = 0;
+
+   std::vector<std::thread> thieves;
+   for (int i = 0; i < nThieves; ++i) {
+      thieves.emplace_back([&] {
+         while (nTaken.load() < count) {
+            if (auto item = deque.Steal()) {
+               ++taken[*item];
+               ++nTaken;
+            } else {
+               std::this_thread::yield();
+            }
+         }
+      });
+   }
+
+   for (int i = 0; i < count; ++i) {
+      deque.Push(i);
+      if (i % 3 == 0) {
+         if (auto item = deque.Pop()) {
+            ++taken[*item];
+            ++nTaken;
+         }
+      }
+   }
+   while (auto item = deque.Pop()) {
+      ++taken[*item];
+      ++nTaken;
+   }
+
+   for (auto& thief : thieves) {
+      thief.join();
+   }
+   for (int i = 0; i < count; ++i) {
+      ASSERT_EQ(taken[i], 1);
+   }
+}
+
+TEST(ThreadPool, ParallelFor) {
+   ThreadPool pool{ 4 };
+   std::vector<int> visits(100'000, 0);
+   pool.ParallelFor(0, (int)visits.size(), 64, [&](int i) { ++visits[i]; });
+   ASSERT_EQ(std::count(visits.begin(), visits.end(), 1), visits.size());
+
+   // empty and smaller than grain
+   pool.ParallelFor(0, 0, 64, [&](int i) { ++visits[i]; });
+   pool.ParallelFor(0, 10, 64, [&](int i) { ++visits[i]; });
+   ASSERT_EQ(visits[9], 2);
+}
+
+static int64_t Fibonacci(ThreadPool& pool, int n) {
+   if (n < 12) {
+      return n < 2 ? n : Fibonacci(pool, n - 1) + Fibonacci(pool, n - 2);
+   }
+   int64_t a = 0;
+   TaskGroup group{ pool };
+   group.Run([&] { a = Fibonacci(pool, n - 1); });
+   int64_t b = Fibonacci(pool, n - 2);
+   group.Wait();
+   return a + b;
+}
+
+TEST(ThreadPool, TaskGroup) {
+   ThreadPool pool{ 3 };
+   ASSERT_EQ(Fibonacci(pool, 25), 75025);
+
+   // spawned from several outside threads at once
+   std::atomic<int> sum = 0;
+   std::vector<std::thread> threads;
+   for (int t = 0; t < 3; ++t) {
+      threads.emplace_back([&] {
+         TaskGroup group{ pool };
+         for (int i = 0; i < 1000; ++i) {
+            group.Run([&] { ++sum; });
+         }
+      });
+   }
+   for (auto& thread : threads) {
+      thread.join();
+   }
+   ASSERT_EQ(sum, 3000);
+}
+
+TEST(ThreadPool, TaskStorage) {
+   ThreadPool pool{ 2 };
+
+   // callable bigger than the inline storage
+   std::array<int64_t, 16> big{};
+   big.fill(1);
+   std::atomic<int64_t> sum = 0;
+   {
+      TaskGroup group{ pool };
+      for (int i = 0; i < 100; ++i) {
+         group.Run([big, &sum] { sum += std::accumulate(big.begin(), big.end(), int64_t(0)); });
+      }
+   }
+   ASSERT_EQ(sum, 1600);
+
+   // more pending tasks than slots, workers are held back so the rest runs in place
+   std::atomic<int> count = 0;
+   std::atomic<bool> release = false;
+   int inPlace = 0;
+   auto spawner = std::this_thread::get_id();
+   {
+      TaskGroup group{ pool };
+      for (int i = 0; i < ThreadPool::kMaxPendingTasks + 1000; ++i) {
+         group.Run([&] {
+            if (std::this_thread::get_id() == spawner) {
+               inPlace += !release;
+            } else {
+               while (!release) {
+                  std::this_thread::yield();
+               }
+            }
+            ++count;
+         });
+      }
+      release = true;
+   }
+   ASSERT_EQ(count, ThreadPool::kMaxPendingTasks + 1000);
+   ASSERT_EQ(inPlace, 1000);
+}